@@ -1,7 +1,10 @@
 #pragma once
 #include "SwiftEnums.hpp"
 #include "SwiftStructs.hpp"
+#include "cstring"
 #include "expected"
+#include "filesystem"
+#include "span"
 #include "vector"
 
 namespace Swift
@@ -27,11 +30,32 @@ namespace Swift
     void EndRendering();
 
     void BindShader(const ShaderHandle& shaderHandle);
-    void BindIndexBuffer(BufferHandle bufferHandle);
+    // Index binds and indirect commands fail with eBarrierInsideRendering
+    // when their buffer still needs a barrier inside rendering, see
+    // TransitionBuffers
+    std::expected<void,
+                  Error>
+    BindIndexBuffer(BufferHandle bufferHandle,
+                    uint64_t offset = 0,
+                    IndexType indexType = IndexType::eUint32);
+    std::expected<void,
+                  Error>
+    BindIndexBuffer(const BufferSlice& slice,
+                    IndexType indexType = IndexType::eUint32);
 
     void DispatchCompute(uint32_t groupX,
                          uint32_t groupY,
                          uint32_t groupZ);
+    // Dispatches enough groups of the bound compute shader's reflected
+    // workgroup size to cover the thread counts
+    void DispatchComputeThreads(uint32_t threadX,
+                                uint32_t threadY = 1,
+                                uint32_t threadZ = 1);
+    // Reads a VkDispatchIndirectCommand, see WriteDispatchArgs
+    std::expected<void,
+                  Error>
+    DispatchComputeIndirect(BufferHandle bufferHandle,
+                            uint64_t offset = 0);
 
     void Draw(uint32_t vertexCount,
               uint32_t instanceCount,
@@ -44,17 +68,52 @@ namespace Swift
                      int vertexOffset = 0,
                      uint32_t firstInstance = 0);
 
-    void DrawIndexedIndirect(const BufferHandle& bufferHandle,
+    // One command for every range where VK_EXT_multi_draw is available, a
+    // draw per range elsewhere
+    void MultiDraw(std::span<const DrawRange> draws,
+                   uint32_t instanceCount = 1,
+                   uint32_t firstInstance = 0);
+
+    void MultiDrawIndexed(std::span<const IndexedDrawRange> draws,
+                          uint32_t instanceCount = 1,
+                          uint32_t firstInstance = 0);
+
+    std::expected<void,
+                  Error>
+    DrawIndexedIndirect(const BufferHandle& bufferHandle,
+                        uint64_t offset,
+                        uint32_t drawCount,
+                        uint32_t stride);
+
+    std::expected<void,
+                  Error>
+    DrawIndexedIndirectCount(const BufferHandle& bufferHandle,
                              uint64_t offset,
-                             uint32_t drawCount,
+                             const BufferHandle& countBufferHandle,
+                             uint64_t countOffset,
+                             uint32_t maxDrawCount,
                              uint32_t stride);
 
-    void DrawIndexedIndirectCount(const BufferHandle& bufferHandle,
-                                  uint64_t offset,
-                                  const BufferHandle& countBufferHandle,
-                                  uint64_t countOffset,
-                                  uint32_t maxDrawCount,
-                                  uint32_t stride);
+    // Mesh shader draws, require Features.MeshShader
+    void DrawMeshTasks(uint32_t groupX,
+                       uint32_t groupY = 1,
+                       uint32_t groupZ = 1);
+
+    std::expected<void,
+                  Error>
+    DrawMeshTasksIndirect(const BufferHandle& bufferHandle,
+                          uint64_t offset,
+                          uint32_t drawCount,
+                          uint32_t stride);
+
+    std::expected<void,
+                  Error>
+    DrawMeshTasksIndirectCount(const BufferHandle& bufferHandle,
+                               uint64_t offset,
+                               const BufferHandle& countBufferHandle,
+                               uint64_t countOffset,
+                               uint32_t maxDrawCount,
+                               uint32_t stride);
 
     void ClearSwapchain(Float4 color);
 
@@ -85,6 +144,19 @@ namespace Swift
 
     void SetTopology(Topology topology);
 
+    // Need Features.ExtendedDynamicState3 and do nothing without it. The
+    // bound shader's create info provides the values until these override
+    // them
+    void SetPolygonMode(PolygonMode polygonMode);
+
+    void SetRasterizationSamples(VkSampleCountFlagBits samples);
+
+    void SetBlendState(const BlendState& blendState,
+                       uint32_t attachment = 0);
+
+    // Also needs Features.DepthClamp
+    void SetDepthClamp(bool depthClamp);
+
     // Transfer Operations
     void Resolve(ImageHandle srcImageHandle,
                  ImageHandle resolvedImageHandle);
@@ -108,6 +180,60 @@ namespace Swift
     std::expected<ShaderHandle,
                   Error>
     CreateComputeShader(const ComputeShaderCreateInfo& createInfo);
+    const ShaderReflection& GetShaderReflection(ShaderHandle shaderHandle);
+
+    // Replaces one stage's SPIR-V. The shader is compiled on a worker and
+    // swapped into the same handle at a later BeginFrame, until then the
+    // old code keeps running. Fails right away on invalid code or a stage
+    // the shader doesn't have
+    std::expected<void,
+                  Error>
+    ReloadShader(ShaderHandle shaderHandle,
+                 ShaderStage stage,
+                 std::vector<char> code);
+    // Reloads the stage whenever the file is written, checked at BeginFrame
+    void WatchShaderFile(ShaderHandle shaderHandle,
+                         ShaderStage stage,
+                         const std::filesystem::path& path);
+    void UnwatchShaderFiles(ShaderHandle shaderHandle);
+
+    // Every pipeline compiled so far, with its compile time and whether the
+    // pipeline cache had it
+    std::span<const PipelineRecord> GetPipelineRecords();
+    // Pass to InitInfo::SetPipelineCacheData in the next run
+    std::vector<char> GetPipelineCacheData();
+    // Writes the graphics pipelines of every shader created so far to a
+    // list ReplayPipelineList can compile ahead of use
+    std::expected<void,
+                  Error>
+    SavePipelineList(const std::filesystem::path& path);
+    // Compiles a saved list on threadCount workers, 0 uses every core, so
+    // CreateGraphicsShader finds the pipelines ready. Call after Init and
+    // before the first frame. Returns how many pipelines were compiled
+    std::expected<uint32_t,
+                  Error>
+    ReplayPipelineList(const std::filesystem::path& path,
+                       uint32_t threadCount = 0);
+
+    // Query Operations
+    // A query can run once per frame. Fails when every slot of its kind is
+    // taken or the device lacks the feature its type needs
+    std::expected<QueryHandle,
+                  Error>
+    CreateQuery(QueryType type);
+    void BeginQuery(QueryHandle queryHandle);
+    void EndQuery(QueryHandle queryHandle);
+    // Never waits, results arrive once the frame that ran the query has
+    // finished, a few frames later. Empty until the first one does
+    std::optional<QueryResult> GetQueryResult(QueryHandle queryHandle);
+    // Draws and dispatches until EndConditionalRendering are skipped when
+    // the occlusion query, ended earlier this frame, saw no samples. Call
+    // outside rendering. Without DeviceFeatures::ConditionalRendering, when
+    // called inside rendering, or with a query that isn't an occlusion query
+    // ended this frame, everything is drawn
+    void BeginConditionalRendering(QueryHandle queryHandle,
+                                   bool inverted = false);
+    void EndConditionalRendering();
 
     // Image Operations
     std::expected<ImageHandle,
@@ -115,6 +241,15 @@ namespace Swift
     CreateImage(const ImageCreateInfo& createInfo);
     void DestroyImage(ImageHandle handle);
 
+    // Registers a view over a mip range of an existing image as its own
+    // handle, with sampled and storage descriptors that expect the image to
+    // be in VK_IMAGE_LAYOUT_GENERAL
+    std::expected<ImageHandle,
+                  Error>
+    CreateImageView(ImageHandle imageHandle,
+                    uint32_t baseMip,
+                    uint32_t mipCount = 1);
+
     std::expected<TempImageHandle,
                   Error>
     CreateTempImage(const ImageCreateInfo& createInfo);
@@ -158,6 +293,59 @@ namespace Swift
                       uint64_t offset,
                       uint64_t size);
 
+    // Repeats value over the range, offset and size must be multiples of 4
+    void FillBuffer(BufferHandle bufferHandle,
+                    uint32_t value,
+                    uint64_t offset = 0,
+                    uint64_t size = VK_WHOLE_SIZE);
+
+    // Bump allocates from the current frame's persistently mapped buffer. The
+    // memory is reused once this frame's fence has been waited on again, so
+    // it is only valid for commands recorded this frame. The alignment must
+    // be a power of two
+    std::expected<TransientAllocation,
+                  Error>
+    AllocateTransient(uint64_t size,
+                      uint64_t alignment = 16);
+
+    template <typename T>
+    std::expected<TransientAllocation,
+                  Error>
+    AllocateTransient(const T& value)
+    {
+        constexpr uint64_t alignment = alignof(T) < 16 ? 16 : alignof(T);
+        auto allocation = AllocateTransient(sizeof(T), alignment);
+        if (allocation)
+        {
+            std::memcpy(allocation->Data, &value, sizeof(T));
+        }
+        return allocation;
+    }
+
+    // Suballocates slices out of a few large buffers, so thousands of meshes
+    // can share one index buffer binding and stable device addresses
+    std::expected<BufferPoolHandle,
+                  Error>
+    CreateBufferPool(const BufferPoolCreateInfo& createInfo);
+    void DestroyBufferPool(BufferPoolHandle poolHandle);
+
+    std::expected<BufferSlice,
+                  Error>
+    AllocateSlice(BufferPoolHandle poolHandle,
+                  uint64_t size,
+                  uint64_t alignment = 16);
+    void FreeSlice(BufferPoolHandle poolHandle,
+                   const BufferSlice& slice);
+
+    // Copies a mesh's indices into the pool, narrowing them to 16 bits when
+    // every index fits. Meshes of the same index type in the same block can
+    // then be drawn from a single BindIndexBuffer using FirstIndex. Fails
+    // with eInvalidArgument when there are no indices
+    std::expected<PackedIndices,
+                  Error>
+    PackIndices(BufferPoolHandle poolHandle,
+                std::span<const uint32_t> indices);
+
     // Misc
     void WaitIdle();
 
@@ -165,6 +353,20 @@ namespace Swift
     TransitionImage(ImageHandle imageHandle,
                     VkImageLayout newLayout,
                     VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT);
+    // Buffers remember their last write and the reads since, so only the
+    // barriers a hazard needs are recorded. The state is kept per buffer, so
+    // barriers cover the whole buffer, or the current frame's copy of a
+    // dynamic one. Copies, updates, index binds and indirect draws transition
+    // their buffers themselves, but no barrier can be recorded inside
+    // rendering. A command that needs one there fails, and the barrier is
+    // recorded at the next BeginRendering so later passes succeed. Transition
+    // buffers read by draws before BeginRendering to avoid that. Shaders reach
+    // buffers through addresses, so dispatches and draws never transition the
+    // buffers they access
+    void TransitionBuffer(BufferHandle bufferHandle,
+                          VkPipelineStageFlags2 stage,
+                          VkAccessFlags2 access);
+    void TransitionBuffers(std::span<const BufferTransition> transitions);
     void CopyBufferToImage(BufferHandle srcBuffer,
                            ImageHandle dstImageHandle,
                            const std::vector<BufferImageCopy>& copyRegions);
@@ -174,4 +376,9 @@ namespace Swift
     Queue GetTransferQueue();
     Command GetGraphicsCommand();
     Command GetTransferCommand();
+
+    // Swift skips binds and dynamic state that the graphics command buffer
+    // already has. Call this after recording commands into it directly, such
+    // as an ImGui render pass, so the next calls record everything again
+    void InvalidateCommandState();
 } // namespace Swift
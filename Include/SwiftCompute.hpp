@@ -0,0 +1,102 @@
+#pragma once
+#include "SwiftEnums.hpp"
+#include "SwiftStructs.hpp"
+#include "expected"
+
+namespace Swift
+{
+    enum class ScanType
+    {
+        eExclusive,
+        eInclusive,
+    };
+
+    enum class ReduceOp
+    {
+        eSum,
+        eMin,
+        eMax,
+    };
+
+    // Temporary storage for the primitives, sized for the largest element
+    // count they will be run on
+    struct ComputeScratch
+    {
+        BufferHandle Buffer = InvalidHandle;
+        uint32_t MaxCount{};
+    };
+
+    std::expected<void,
+                  Error>
+    InitCompute();
+
+    // Turns a uint32_t element count written on the GPU into a
+    // VkDispatchIndirectCommand of enough groups of the consuming compute
+    // shader's local size, so it can process another pass's output with
+    // DispatchComputeIndirect and no readback. Fails with eInvalidArgument
+    // when the consumer has no reflected local size. Must be called
+    // outside of rendering and binds its own shader, so bind the consuming
+    // shader after
+    std::expected<void,
+                  Error>
+    WriteDispatchArgs(BufferHandle countBuffer,
+                      uint64_t countOffset,
+                      BufferHandle argsBuffer,
+                      uint64_t argsOffset,
+                      ShaderHandle consumer);
+
+    std::expected<ComputeScratch,
+                  Error>
+    CreateComputeScratch(uint32_t maxCount);
+    void DestroyComputeScratch(const ComputeScratch& scratch);
+
+    // The primitives below work on tightly packed uint32_t elements and use
+    // subgroup operations when the device supports them. Like
+    // WriteDispatchArgs they must be called outside of rendering, bind their
+    // own shaders and transition the buffers they touch. Those taking a
+    // scratch fail with eInvalidArgument when count exceeds its MaxCount
+
+    // The output may be the input
+    std::expected<void,
+                  Error>
+    PrefixSum(BufferHandle input,
+              BufferHandle output,
+              uint32_t count,
+              const ComputeScratch& scratch,
+              ScanType type = ScanType::eExclusive);
+
+    // Keeps the elements with a non zero flag in order and writes how many
+    // were kept to outputCount, ready for WriteDispatchArgs
+    std::expected<void,
+                  Error>
+    Compact(BufferHandle input,
+            BufferHandle flags,
+            BufferHandle output,
+            BufferHandle outputCount,
+            uint32_t count,
+            const ComputeScratch& scratch);
+
+    // Stable ascending sort in place, 4 bits per pass. Values may be
+    // InvalidHandle to sort keys only, and keyBits skips passes for keys
+    // known to be small
+    std::expected<void,
+                  Error>
+    RadixSort(BufferHandle keys,
+              BufferHandle values,
+              uint32_t count,
+              const ComputeScratch& scratch,
+              uint32_t keyBits = 32);
+
+    // Writes the reduction to the first element of result
+    void Reduce(BufferHandle input,
+                BufferHandle result,
+                uint32_t count,
+                ReduceOp op = ReduceOp::eSum);
+
+    // Counts every element in bin (element >> shift) % binCount
+    void Histogram(BufferHandle input,
+                   BufferHandle bins,
+                   uint32_t count,
+                   uint32_t binCount,
+                   uint32_t shift = 0);
+} // namespace Swift
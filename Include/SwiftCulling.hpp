@@ -0,0 +1,110 @@
+#pragma once
+#include "SwiftEnums.hpp"
+#include "SwiftStructs.hpp"
+#include "array"
+#include "expected"
+#include "vector"
+
+namespace Swift
+{
+    // Matches the layout the culling shader reads, one entry per object
+    struct CullInstance
+    {
+        // xyz is the world space center, w the radius
+        Float4 BoundingSphere;
+        uint32_t IndexCount;
+        uint32_t FirstIndex;
+        int32_t VertexOffset;
+        uint32_t MaterialIndex;
+    };
+
+    struct CullView
+    {
+        // World space planes with normals pointing inwards, a point p is inside
+        // when dot(plane.xyz, p) + plane.w >= 0
+        std::array<Float4, 6> FrustumPlanes;
+        // Column major, the view space is right handed and looks down -z. Only
+        // read by the occlusion test
+        std::array<Float4, 4> ViewMatrix{};
+        std::array<Float4, 4> ProjectionMatrix{};
+    };
+
+    struct CullOutput
+    {
+        // VkDrawIndexedIndirectCommand records, FirstInstance holds the index
+        // of the instance that produced the draw
+        BufferHandle Commands = InvalidHandle;
+        BufferHandle Count = InvalidHandle;
+        uint32_t MaxDraws{};
+    };
+
+    // A conservative depth mip chain of the depth buffer, every texel
+    // holds the farthest depth of the texels it covers
+    struct DepthPyramid
+    {
+        ImageHandle Image = InvalidHandle;
+        // Views that expect the image to stay in VK_IMAGE_LAYOUT_GENERAL
+        ImageHandle FullView = InvalidHandle;
+        std::vector<ImageHandle> MipViews;
+        Int2 Extent{};
+        bool ReverseZ = false;
+    };
+
+    enum class CullPhase
+    {
+        // Frustum culling only
+        eFrustum,
+        // Draws what was visible last frame, before the pyramid is built
+        eEarly,
+        // Tests everything against this frame's pyramid, draws what the early
+        // phase missed and records visibility for the next frame
+        eLate,
+    };
+
+    struct OcclusionCullInfo
+    {
+        CullPhase Phase = CullPhase::eFrustum;
+        // One uint32_t per instance, cleared to zero before first use
+        BufferHandle Visibility = InvalidHandle;
+        // Only read by the late phase
+        const DepthPyramid* Pyramid = nullptr;
+    };
+
+    // Fails with eFeatureNotSupported without
+    // DeviceFeatures::DrawIndirectFirstInstance
+    std::expected<void,
+                  Error>
+    InitCulling();
+
+    // The pyramid is sized to the previous power of two of the depth buffer
+    std::expected<DepthPyramid,
+                  Error>
+    CreateDepthPyramid(Int2 depthExtent,
+                       bool reverseZ = false);
+    void DestroyDepthPyramid(const DepthPyramid& pyramid);
+
+    // Must be called outside of rendering. Leaves the depth image in
+    // VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and binds the reduction shader
+    void BuildDepthPyramid(const DepthPyramid& pyramid,
+                           ImageHandle depthImage);
+
+    std::expected<CullOutput,
+                  Error>
+    CreateCullOutput(uint32_t maxDraws);
+    void DestroyCullOutput(const CullOutput& output);
+
+    // Records the culling dispatch, must be called outside of rendering. This
+    // binds the culling compute shader, so bind a graphics shader again
+    // before the next BeginRendering
+    std::expected<void,
+                  Error>
+    CullInstances(BufferHandle instanceBuffer,
+                  uint32_t instanceCount,
+                  const CullView& view,
+                  const CullOutput& output,
+                  const OcclusionCullInfo& occlusion = {});
+
+    std::expected<void,
+                  Error>
+    DrawCulled(const CullOutput& output);
+} // namespace Swift
@@ -0,0 +1,73 @@
+#pragma once
+#include "SwiftEnums.hpp"
+#include "SwiftStructs.hpp"
+#include "cstring"
+#include "expected"
+#include "vector"
+
+namespace Swift
+{
+    struct DrawPacket
+    {
+        ShaderHandle Shader = InvalidHandle;
+        // Only orders the draws, pass the material to the shader through
+        // the push constant payload
+        uint32_t Material{};
+        PackedIndices Mesh{};
+        int32_t VertexOffset{};
+        uint32_t InstanceCount = 1;
+        uint32_t FirstInstance{};
+        // View space distance, opaque draws go front to back and transparent
+        // draws back to front
+        float Depth{};
+        bool Transparent = false;
+    };
+
+    // Packets sorted by a 64 bit key so draws sharing a shader, material and
+    // index buffer run back to back. Opaque keys are shader, material then
+    // depth, transparent keys put the depth first to keep blending correct
+    struct DrawQueue
+    {
+        struct Entry
+        {
+            uint64_t Key;
+            uint32_t Packet;
+        };
+
+        struct QueuedPacket
+        {
+            DrawPacket Packet;
+            uint32_t PushOffset;
+            uint32_t PushSize;
+        };
+
+        std::vector<QueuedPacket> Packets;
+        std::vector<Entry> Entries;
+        std::vector<Entry> SortScratch;
+        // Push constant payloads of every packet, copied on push
+        std::vector<std::byte> PushData;
+    };
+
+    void PushDraw(DrawQueue& queue,
+                  const DrawPacket& packet,
+                  const void* pushData = nullptr,
+                  uint32_t pushSize = 0);
+
+    template <typename T>
+    void PushDraw(DrawQueue& queue,
+                  const DrawPacket& packet,
+                  const T& pushConstant)
+    {
+        PushDraw(queue, packet, &pushConstant, sizeof(T));
+    }
+
+    // Sorts and records every queued draw, must be called inside rendering.
+    // Leaves the last packet's shader bound and empties the queue. Index
+    // buffers written this frame have to be transitioned for index reads
+    // before BeginRendering. Draws from one that is not are skipped and the
+    // submit fails with eBarrierInsideRendering, the next pass draws them
+    std::expected<void,
+                  Error>
+    SubmitDrawQueue(DrawQueue& queue);
+    void ClearDrawQueue(DrawQueue& queue);
+} // namespace Swift
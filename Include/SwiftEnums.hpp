@@ -29,7 +29,13 @@ namespace Swift
         eImageNotFound,
         eBufferNotFound,
         eBufferMapFailed,
-        eCopyFailed
+        eCopyFailed,
+        eOutOfTransientMemory,
+        ePipelineListFailed,
+        eQueryCreateFailed,
+        eInvalidArgument,
+        eBarrierInsideRendering,
+        eFeatureNotSupported
     };
 
     enum class DeviceType
@@ -43,7 +49,9 @@ namespace Swift
         eVertex,
         eGeometry,
         eFragment,
-        eCompute
+        eCompute,
+        eTask,
+        eMesh
     };
 
     enum class BufferUsage
@@ -52,7 +60,29 @@ namespace Swift
         eStorage,
         eIndex,
         eIndirect,
-        eReadback
+        eReadback,
+        eTransient,
+        eGeometry,
+        // Conditional rendering predicates, needs
+        // DeviceFeatures::ConditionalRendering
+        ePredicate
+    };
+
+    enum class QueryType
+    {
+        // Exact passing sample count, needs DeviceFeatures::PreciseOcclusion
+        eOcclusion,
+        // Zero or some non-zero count, cheaper on tiled GPUs
+        eBinaryOcclusion,
+        // Vertex and fragment invocations and clipping primitives, needs
+        // DeviceFeatures::PipelineStatistics
+        ePipelineStatistics,
+    };
+
+    enum class IndexType
+    {
+        eUint16,
+        eUint32,
     };
 
     enum class CullMode
@@ -1,5 +1,8 @@
 #pragma once
 #include "SwiftStructs.hpp"
+#include "array"
+#include "bit"
+#include "optional"
 
 namespace Swift
 {
@@ -9,6 +12,12 @@ namespace Swift
         return lhs.x == rhs.x && lhs.y == rhs.y;
     }
 
+    inline bool operator==(const ViewportInfo& lhs,
+                           const ViewportInfo& rhs)
+    {
+        return lhs.Extent == rhs.Extent && lhs.Offset == rhs.Offset;
+    }
+
     inline bool operator!=(const Int2& lhs,
                     const Int2& rhs)
     {
@@ -70,6 +79,72 @@ namespace Swift
         return lhs; 
     }
 
+    inline void HashCombine(uint64_t& seed,
+                            const uint64_t value)
+    {
+        seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    }
+
+    inline bool operator==(const SamplerCreateInfo& lhs,
+                           const SamplerCreateInfo& rhs)
+    {
+        return lhs.MinFilter == rhs.MinFilter &&
+               lhs.MagFilter == rhs.MagFilter &&
+               lhs.MipmapMode == rhs.MipmapMode &&
+               lhs.AddressModeU == rhs.AddressModeU &&
+               lhs.AddressModeV == rhs.AddressModeV &&
+               lhs.AddressModeW == rhs.AddressModeW &&
+               lhs.BorderColor == rhs.BorderColor &&
+               lhs.AnisotropyEnable == rhs.AnisotropyEnable &&
+               lhs.MaxAnisotropy == rhs.MaxAnisotropy &&
+               lhs.CompareEnable == rhs.CompareEnable &&
+               lhs.CompareOp == rhs.CompareOp && lhs.MinLod == rhs.MinLod &&
+               lhs.MaxLod == rhs.MaxLod && lhs.MipLodBias == rhs.MipLodBias &&
+               lhs.ReductionMode == rhs.ReductionMode;
+    }
+
+    // Transparent so modules can be looked up by their code without a copy
+    struct ShaderCodeHash
+    {
+        using is_transparent = void;
+        size_t operator()(const std::string_view code) const
+        {
+            return std::hash<std::string_view>{}(code);
+        }
+    };
+
+    struct SamplerHash
+    {
+        size_t operator()(const SamplerCreateInfo& info) const
+        {
+            uint64_t seed = 0;
+            HashCombine(seed, info.MinFilter);
+            HashCombine(seed, info.MagFilter);
+            HashCombine(seed, info.MipmapMode);
+            HashCombine(seed, info.AddressModeU);
+            HashCombine(seed, info.AddressModeV);
+            HashCombine(seed, info.AddressModeW);
+            HashCombine(seed, info.BorderColor);
+            HashCombine(seed, info.AnisotropyEnable);
+            HashCombine(seed, std::bit_cast<uint32_t>(info.MaxAnisotropy));
+            HashCombine(seed, info.CompareEnable);
+            HashCombine(seed, info.CompareOp);
+            HashCombine(seed, std::bit_cast<uint32_t>(info.MinLod));
+            HashCombine(seed, std::bit_cast<uint32_t>(info.MaxLod));
+            HashCombine(seed, std::bit_cast<uint32_t>(info.MipLodBias));
+            HashCombine(seed, info.ReductionMode);
+            return seed;
+        }
+    };
+
+    // Built-in shaders are embedded as uint32 arrays by glslc
+    template <size_t N>
+    std::vector<char> GetEmbeddedShaderCode(const uint32_t (&code)[N])
+    {
+        const auto* bytes = reinterpret_cast<const char*>(code);
+        return std::vector<char>(bytes, bytes + sizeof(code));
+    }
+
     struct SubmitInfo
     {
         VkSemaphore WaitSemaphore;
@@ -79,12 +154,6 @@ namespace Swift
         VkFence Fence;
     };
 
-    struct ShaderInfo
-    {
-        VkShaderModule ShaderModule;
-        VkPipelineShaderStageCreateInfo ShaderStage;
-    };
-
     struct Descriptor
     {
         VkDescriptorSetLayout Layout;
@@ -98,6 +167,18 @@ namespace Swift
         VkPipelineBindPoint BindPoint;
         std::vector<VkRenderingAttachmentInfo> ColorAttachments;
         VkRenderingAttachmentInfo DepthAttachment;
+        ShaderReflection Reflection;
+        // Dynamic state defaults BindShader applies
+        DepthStencilState DepthStencil;
+        RasterState Raster;
+        // Applied on bind with extended dynamic state 3
+        std::vector<BlendState> BlendStates;
+        Swift::PolygonMode PolygonMode{};
+        VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
+        Swift::Topology Topology = Swift::Topology::eTriangleList;
+        // Set instead of the pipeline with DeviceFeatures::ShaderObject
+        std::vector<VkShaderEXT> ShaderObjects;
+        std::vector<VkShaderStageFlagBits> ShaderObjectStages;
     };
 
     struct Image
@@ -110,6 +191,19 @@ namespace Swift
         uint32_t MipLevels = 1;
         uint32_t ArrayLayers = 1;
         SamplerHandle Sampler = InvalidHandle;
+        VkFormat Format{};
+        VkImageUsageFlags Usage{};
+        // Views created with CreateImageView share the parent's image and
+        // have no allocation of their own
+        uint32_t BaseMip = 0;
+    };
+
+    // Stages a read has been made visible to, and the access types it made
+    // visible to them
+    struct BufferRead
+    {
+        VkPipelineStageFlags2 Stages{};
+        VkAccessFlags2 Access{};
     };
 
     struct Buffer
@@ -117,8 +211,30 @@ namespace Swift
         VkBuffer BaseBuffer{};
         VmaAllocation Allocation{};
         VmaAllocationInfo AllocationInfo{};
+        uint64_t Address{};
+        uint64_t Size{};
+        // Distance between the per frame copies of a dynamic buffer
+        uint64_t VersionStride{};
+        bool Dynamic = false;
+        // Last write and the reads since, see Vulkan::GetBufferBarrier
+        VkPipelineStageFlags2 WriteStages{};
+        VkAccessFlags2 WriteAccess{};
+        std::vector<BufferRead> Reads;
     };
     
+    struct BufferPoolBlock
+    {
+        BufferHandle Buffer = InvalidHandle;
+        VmaVirtualBlock VirtualBlock{};
+    };
+
+    struct BufferPool
+    {
+        BufferUsage Usage;
+        uint64_t BlockSize{};
+        std::vector<BufferPoolBlock> Blocks;
+    };
+
     struct Swapchain
     {
         vkb::Swapchain SwapChain;
@@ -128,11 +244,62 @@ namespace Swift
         uint32_t CurrentImageIndex;
     };
 
+    // What the frame's command buffer has recorded so far, so setters can
+    // drop commands that would not change anything. Indexed by bind point
+    // where graphics and compute keep separate bindings
+    struct CommandState
+    {
+        std::array<VkPipeline, 2> Pipelines{};
+        std::array<bool, 2> DescriptorSetBound{};
+        std::optional<ViewportInfo> Viewport;
+        std::optional<ViewportInfo> Scissor;
+        std::optional<Swift::CullMode> CullMode;
+        std::optional<bool> DepthTest;
+        std::optional<bool> DepthWrite;
+        std::optional<Swift::DepthCompareOp> DepthCompareOp;
+        std::optional<Swift::FrontFace> FrontFace;
+        std::optional<float> LineWidth;
+        std::optional<Swift::Topology> Topology;
+        std::optional<Swift::PolygonMode> PolygonMode;
+        std::optional<VkSampleCountFlagBits> Samples;
+        std::optional<bool> DepthClamp;
+        std::vector<std::optional<BlendState>> BlendStates;
+        // Graphics shader whose stage objects are bound
+        uint32_t ShaderObjects = InvalidHandle;
+        // Whether the state shader objects need and Swift never changes has
+        // been set
+        bool ShaderObjectDefaults = false;
+    };
+
     struct FrameData
     {
         Command Command;
         VkSemaphore ImageAvailable;
         VkSemaphore RenderFinished;
         VkFence Fence;
+        BufferHandle TransientBuffer = InvalidHandle;
+        std::byte* TransientData = nullptr;
+        uint64_t TransientAddress = 0;
+        uint64_t TransientOffset = 0;
+        uint64_t TransientSize = 0;
+        CommandState State;
+        // Destroyed after the frame's fence is next waited on
+        std::vector<VkPipeline> RetiredPipelines;
+        std::vector<VkShaderEXT> RetiredShaderObjects;
+        // Occlusion and pipeline statistics pools, a query has the same
+        // slot in every frame
+        std::array<VkQueryPool, 2> QueryPools{};
+        // Read back after the frame's fence is next waited on
+        std::vector<QueryHandle> EndedQueries;
+        uint64_t FrameNumber = 0;
+        // Occlusion results copied for conditional rendering
+        BufferHandle PredicateBuffer = InvalidHandle;
+    };
+
+    struct Query
+    {
+        QueryType Type;
+        uint32_t Slot;
+        std::optional<QueryResult> Result;
     };
 }
\ No newline at end of file
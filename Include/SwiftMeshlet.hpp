@@ -0,0 +1,79 @@
+#pragma once
+#include "SwiftEnums.hpp"
+#include "SwiftStructs.hpp"
+#include "expected"
+#include "span"
+#include "vector"
+
+namespace Swift
+{
+    struct MeshletLimits
+    {
+        // At most 256 vertices, triangles address them with 8 bit indices
+        uint32_t MaxVertices = 64;
+        uint32_t MaxTriangles = 124;
+    };
+
+    struct MeshletSource
+    {
+        std::span<const uint32_t> Indices;
+        // Every vertex starts with its xyz position as floats
+        std::span<const std::byte> Vertices;
+        uint32_t VertexStride = 3 * sizeof(float);
+    };
+
+    // 32 bytes, std430 compatible so task and mesh shaders can read it
+    // through a device address
+    struct Meshlet
+    {
+        // xyz is the object space center, w the radius
+        Float4 BoundingSphere;
+        // Cone axis in xyz and cutoff in w as snorm8. With the axis
+        // normalized, every triangle faces away from the eye when
+        // dot(center - eye, axis) >= cutoff * length(center - eye) + radius.
+        // A cutoff of 127 means the cone never culls
+        uint32_t Cone;
+        // First entry in the vertex array
+        uint32_t VertexOffset;
+        // First byte in the triangle array, always a multiple of 4
+        uint32_t TriangleOffset;
+        uint16_t VertexCount;
+        uint16_t TriangleCount;
+    };
+    static_assert(sizeof(Meshlet) == 32);
+
+    struct MeshletData
+    {
+        std::vector<Meshlet> Meshlets;
+        // Indices into the source vertices, the meshlets' local vertices
+        std::vector<uint32_t> Vertices;
+        // Three local vertex indices per triangle, padded per meshlet
+        std::vector<uint8_t> Triangles;
+    };
+
+    // One slice holding the meshlets, then the vertex and triangle arrays
+    struct MeshletBuffer
+    {
+        BufferSlice Slice;
+        uint32_t MeshletCount{};
+        uint64_t MeshletAddress{};
+        uint64_t VertexAddress{};
+        uint64_t TriangleAddress{};
+    };
+
+    // Walks the triangles in index order, so clusters are as tight as the
+    // index order is local. Run a vertex cache optimizer over the indices
+    // first for the best results
+    MeshletData BuildMeshlets(const MeshletSource& source,
+                              const MeshletLimits& limits = {});
+
+    // Builds every mesh on a worker pool, threadCount 0 uses every core
+    std::vector<MeshletData> BuildMeshlets(std::span<const MeshletSource> sources,
+                                           const MeshletLimits& limits = {},
+                                           uint32_t threadCount = 0);
+
+    std::expected<MeshletBuffer,
+                  Error>
+    UploadMeshlets(BufferPoolHandle poolHandle,
+                   const MeshletData& data);
+} // namespace Swift
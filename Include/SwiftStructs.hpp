@@ -1,5 +1,8 @@
 #pragma once
 #include "SwiftEnums.hpp"
+#include "array"
+#include "cstring"
+#include "optional"
 #include "variant"
 #define VK_NO_PROTOTYPES
 #include "VkBootstrap.h"
@@ -43,6 +46,14 @@ namespace Swift
         int AdditionalOpticalFlowQueueCount = 0;
         VkPhysicalDeviceVulkan12Features AdditionalFeatures12{};
         VkPhysicalDeviceVulkan13Features AdditionalFeatures13{};
+        // Size of each frame in flight's transient linear allocator
+        uint64_t TransientBufferSize = 8 * 1024 * 1024;
+        // Builds graphics shaders from VK_EXT_shader_object stage objects
+        // when the device has them, see DeviceFeatures::ShaderObject
+        bool UseShaderObjects = false;
+        // From GetPipelineCacheData in an earlier run, the driver ignores it
+        // when it was saved on another device or driver
+        std::vector<char> PipelineCacheData;
 
         auto& SetAppName(const std::string& name)
         {
@@ -109,6 +120,21 @@ namespace Swift
             AdditionalFeatures13 = additionalFeatures13;
             return *this;
         }
+        auto& SetTransientBufferSize(const uint64_t transientBufferSize)
+        {
+            TransientBufferSize = transientBufferSize;
+            return *this;
+        }
+        auto& SetUseShaderObjects(const bool useShaderObjects)
+        {
+            UseShaderObjects = useShaderObjects;
+            return *this;
+        }
+        auto& SetPipelineCacheData(const std::vector<char>& pipelineCacheData)
+        {
+            PipelineCacheData = pipelineCacheData;
+            return *this;
+        }
     };
 
     struct DynamicInfo
@@ -127,6 +153,8 @@ namespace Swift
     using TempImageHandle = uint32_t;
     using SamplerHandle = uint32_t;
     using BufferHandle = uint32_t;
+    using BufferPoolHandle = uint32_t;
+    using QueryHandle = uint32_t;
     inline uint32_t InvalidHandle = std::numeric_limits<uint32_t>::max();
 
     struct Command
@@ -141,6 +169,40 @@ namespace Swift
         uint32_t QueueIndex;
     };
 
+    // Optional capabilities that ended up enabled on the device
+    struct DeviceFeatures
+    {
+        // Min/max reduction samplers, including on R32_SFLOAT images
+        bool SamplerFilterMinmax = false;
+        // Basic and arithmetic subgroup operations in compute shaders
+        bool SubgroupArithmetic = false;
+        // VK_EXT_multi_draw
+        bool MultiDraw = false;
+        uint32_t MaxMultiDrawCount{};
+        // VK_EXT_mesh_shader with task shaders
+        bool MeshShader = false;
+        bool DepthClamp = false;
+        // SamplerCreateInfo::AnisotropyEnable is ignored without it
+        bool SamplerAnisotropy = false;
+        // Indirect draws with a FirstInstance, needed by InitCulling
+        bool DrawIndirectFirstInstance = false;
+        // VK_EXT_extended_dynamic_state3 for polygon mode, sample count,
+        // blending, write masks and depth clamp. Pipelines that only differ
+        // in those then share one VkPipeline
+        bool ExtendedDynamicState3 = false;
+        // Graphics shaders are unlinked from formats and sample counts and
+        // bind as stage objects with every piece of state dynamic. Compute
+        // shaders stay pipelines
+        bool ShaderObject = false;
+        // VK_EXT_graphics_pipeline_library, pipelines are fast linked from
+        // cached parts and replaced by an optimized link once it finishes
+        bool GraphicsPipelineLibrary = false;
+        bool PreciseOcclusion = false;
+        bool PipelineStatistics = false;
+        // VK_EXT_conditional_rendering
+        bool ConditionalRendering = false;
+    };
+
     struct Context
     {
         vkb::Instance Instance;
@@ -148,6 +210,118 @@ namespace Swift
         vkb::PhysicalDevice GPU;
         VmaAllocator Allocator{};
         VkSurfaceKHR Surface{};
+        DeviceFeatures Features{};
+    };
+
+    // Values for the shader's constant_id constants, bools are stored as
+    // VkBool32 like SPIR-V expects
+    struct SpecializationConstants
+    {
+        std::vector<VkSpecializationMapEntry> Entries;
+        std::vector<std::byte> Data;
+
+        template <typename T>
+        auto& Add(const uint32_t constantId,
+                  const T& value)
+        {
+            static_assert(std::is_arithmetic_v<T>,
+                          "Specialization constants are scalars");
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                return Add(constantId, static_cast<VkBool32>(value));
+            }
+            else
+            {
+                const auto offset = static_cast<uint32_t>(Data.size());
+                Data.resize(offset + sizeof(T));
+                std::memcpy(Data.data() + offset, &value, sizeof(T));
+                Entries.emplace_back(constantId, offset, sizeof(T));
+                return *this;
+            }
+        }
+
+        // Maps the listed members to consecutive constant ids, e.g.
+        // FromStruct(options, 0, &Options::GroupSize, &Options::UseFog)
+        template <typename T,
+                  typename... Members>
+        static SpecializationConstants FromStruct(const T& value,
+                                                  uint32_t firstConstantId,
+                                                  Members T::*... members)
+        {
+            SpecializationConstants constants;
+            (constants.Add(firstConstantId++, value.*members), ...);
+            return constants;
+        }
+    };
+
+    struct ShaderSpecialization
+    {
+        SpecializationConstants Constants;
+        std::string EntryPoint = "main";
+    };
+
+    struct ShaderEntryPoint
+    {
+        std::string Name;
+        ShaderStage Stage;
+    };
+
+    // What the SPIR-V of a shader's stages declares, merged over the stages
+    struct ShaderReflection
+    {
+        // End of the push constant block, 0 when no stage has one
+        uint32_t PushConstantSize{};
+        // Workgroup size after specialization, of the compute stage or the
+        // first task or mesh stage. Zero for vertex pipelines
+        std::array<uint32_t, 3> LocalSize{};
+        // Bit n is set when a stage declares a variable at binding n of the
+        // bindless set
+        uint32_t BindingMask{};
+        std::vector<ShaderEntryPoint> EntryPoints;
+    };
+
+    // Defaults to alpha blending, turn blending off for opaque targets
+    struct BlendState
+    {
+        bool BlendEnable = true;
+        VkBlendFactor SrcColorFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        VkBlendFactor DstColorFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        VkBlendOp ColorOp = VK_BLEND_OP_ADD;
+        VkBlendFactor SrcAlphaFactor = VK_BLEND_FACTOR_ONE;
+        VkBlendFactor DstAlphaFactor = VK_BLEND_FACTOR_ZERO;
+        VkBlendOp AlphaOp = VK_BLEND_OP_ADD;
+        VkColorComponentFlags WriteMask =
+            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+            VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+        bool operator==(const BlendState&) const = default;
+    };
+
+    // Depth test, write and compare op are dynamic state. When set here,
+    // BindShader applies them, otherwise the last Set* call stays in effect
+    struct DepthStencilState
+    {
+        std::optional<bool> DepthTest;
+        std::optional<bool> DepthWrite;
+        std::optional<Swift::DepthCompareOp> DepthCompareOp;
+        // Needs a DepthFormat with stencil, such as
+        // VK_FORMAT_D24_UNORM_S8_UINT, the attachment is then used for both
+        bool StencilTest = false;
+        VkStencilOpState StencilFront{};
+        VkStencilOpState StencilBack{};
+    };
+
+    // Cull mode and front face are dynamic like the depth state above
+    struct RasterState
+    {
+        std::optional<Swift::CullMode> CullMode;
+        std::optional<Swift::FrontFace> FrontFace;
+        bool DepthBiasEnable = false;
+        float DepthBiasConstantFactor{};
+        float DepthBiasClamp{};
+        float DepthBiasSlopeFactor{};
+        // Needs DeviceFeatures::DepthClamp
+        bool DepthClampEnable = false;
     };
 
     struct GraphicsShaderCreateInfo
@@ -155,16 +329,55 @@ namespace Swift
         std::vector<char> VertexCode;
         std::vector<char> GeometryCode;
         std::vector<char> FragmentCode;
+        // Mesh code replaces the vertex and geometry stages, task code is
+        // optional in front of it. Needs DeviceFeatures::MeshShader
+        std::vector<char> TaskCode;
+        std::vector<char> MeshCode;
         std::vector<VkFormat> ColorFormats;
         VkFormat DepthFormat;
         VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
         VkPolygonMode PolygonMode = VK_POLYGON_MODE_FILL;
         VkPrimitiveTopology Topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        // One per color format, attachments without one use the default
+        std::vector<BlendState> BlendStates;
+        DepthStencilState DepthStencil;
+        RasterState Raster;
+        ShaderSpecialization VertexSpecialization;
+        ShaderSpecialization GeometrySpecialization;
+        ShaderSpecialization FragmentSpecialization;
+        ShaderSpecialization TaskSpecialization;
+        ShaderSpecialization MeshSpecialization;
     };
 
     struct ComputeShaderCreateInfo
     {
         std::vector<char> ComputeCode;
+        ShaderSpecialization Specialization;
+    };
+
+    // One pipeline compile, see GetPipelineRecords
+    struct PipelineRecord
+    {
+        uint64_t Hash{};
+        // Driver reported creation time, CPU time when it reports none
+        uint64_t DurationNs{};
+        // Frames begun before the compile, 0 for compiles during loading
+        uint64_t Frame{};
+        // The driver took the pipeline from the pipeline cache
+        bool CacheHit = false;
+        // Compiled by ReplayPipelineList instead of on first use
+        bool Replayed = false;
+    };
+
+    // Occlusion queries fill Samples, statistics queries the rest
+    struct QueryResult
+    {
+        uint64_t Samples{};
+        uint64_t VertexInvocations{};
+        uint64_t ClippingPrimitives{};
+        uint64_t FragmentInvocations{};
+        // Frame the query ran in, counted like PipelineRecord::Frame
+        uint64_t Frame{};
     };
 
     struct ImageCreateInfo
@@ -187,12 +400,63 @@ namespace Swift
         VkSamplerAddressMode AddressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
         VkSamplerAddressMode AddressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
         VkBorderColor BorderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+        // Anisotropy is clamped to the device's maxSamplerAnisotropy and
+        // needs DeviceFeatures::SamplerAnisotropy
+        bool AnisotropyEnable = false;
+        float MaxAnisotropy = 16.f;
+        bool CompareEnable = false;
+        VkCompareOp CompareOp = VK_COMPARE_OP_ALWAYS;
+        float MinLod = 0.f;
+        float MaxLod = VK_LOD_CLAMP_NONE;
+        float MipLodBias = 0.f;
+        // Min/max reduction needs samplerFilterMinmax
+        VkSamplerReductionMode ReductionMode =
+            VK_SAMPLER_REDUCTION_MODE_WEIGHTED_AVERAGE;
     };
 
     struct BufferCreateInfo
     {
         BufferUsage Usage;
         uint64_t Size;
+        // Keeps one copy per frame in flight, mapping and addressing always
+        // resolve to the current frame's copy so CPU writes never race the GPU
+        bool Dynamic = false;
+    };
+
+    struct BufferPoolCreateInfo
+    {
+        BufferUsage Usage = BufferUsage::eGeometry;
+        // Size of each backing buffer, slices larger than this get a block of
+        // their own
+        uint64_t BlockSize = 64 * 1024 * 1024;
+    };
+
+    struct BufferSlice
+    {
+        BufferHandle Buffer = InvalidHandle;
+        uint64_t Offset{};
+        uint64_t Size{};
+        uint64_t Address{};
+        void* Data{};
+        VmaVirtualAllocation Allocation{};
+    };
+
+    struct PackedIndices
+    {
+        BufferSlice Slice;
+        IndexType Type = IndexType::eUint32;
+        uint32_t IndexCount{};
+        // Index of the first element when the slice's whole buffer is bound
+        // at offset 0 with this index type
+        uint32_t FirstIndex{};
+    };
+
+    struct TransientAllocation
+    {
+        void* Data;
+        uint64_t Address;
+        BufferHandle Buffer;
+        uint64_t Offset;
     };
 
     struct BufferCopy
@@ -202,6 +466,29 @@ namespace Swift
         uint64_t Size;
     };
 
+    // The stages and accesses the next commands use the buffer with
+    struct BufferTransition
+    {
+        BufferHandle Buffer = InvalidHandle;
+        VkPipelineStageFlags2 Stage{};
+        VkAccessFlags2 Access{};
+    };
+
+    // Layout compatible with VkMultiDrawInfoEXT
+    struct DrawRange
+    {
+        uint32_t FirstVertex{};
+        uint32_t VertexCount{};
+    };
+
+    // Layout compatible with VkMultiDrawIndexedInfoEXT
+    struct IndexedDrawRange
+    {
+        uint32_t FirstIndex{};
+        uint32_t IndexCount{};
+        int32_t VertexOffset{};
+    };
+
     struct BufferImageCopy
     {
         uint64_t BufferOffset;
@@ -0,0 +1,143 @@
+// Shared by the primitives. Every workgroup runs GROUP_SIZE threads that own
+// ITEMS_PER_THREAD consecutive elements each. Built once as is and once with
+// SWIFT_SUBGROUP for devices with subgroup arithmetic in compute
+#extension GL_EXT_buffer_reference : require
+#ifdef SWIFT_SUBGROUP
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#endif
+
+#define GROUP_SIZE 256
+#define ITEMS_PER_THREAD 4
+#define BLOCK_SIZE (GROUP_SIZE * ITEMS_PER_THREAD)
+
+layout (local_size_x = GROUP_SIZE) in;
+
+layout (buffer_reference, std430, buffer_reference_align = 4) buffer UintBuffer
+{
+    uint Values[];
+};
+
+shared uint sScratch[GROUP_SIZE];
+shared uint sTotal;
+
+// Returns the sum of value over the lower invocations of the workgroup, and
+// the sum over all of them in total. Must be called in uniform control flow
+uint WorkgroupExclusiveScan(uint value, out uint total)
+{
+    const uint id = gl_LocalInvocationID.x;
+    // A previous call may still be reading the scratch memory
+    barrier();
+#ifdef SWIFT_SUBGROUP
+    const uint inclusive = subgroupInclusiveAdd(value);
+    if (gl_SubgroupInvocationID == gl_SubgroupSize - 1)
+    {
+        sScratch[gl_SubgroupID] = inclusive;
+    }
+    barrier();
+    if (gl_SubgroupID == 0)
+    {
+        // Small subgroups leave more subgroup sums than one subgroup has lanes
+        uint carry = 0;
+        for (uint base = 0; base < gl_NumSubgroups; base += gl_SubgroupSize)
+        {
+            const uint index = base + gl_SubgroupInvocationID;
+            const uint sum = index < gl_NumSubgroups ? sScratch[index] : 0;
+            const uint scanned = subgroupExclusiveAdd(sum);
+            if (index < gl_NumSubgroups)
+            {
+                sScratch[index] = carry + scanned;
+            }
+            carry += subgroupAdd(sum);
+        }
+        if (gl_SubgroupInvocationID == 0)
+        {
+            sTotal = carry;
+        }
+    }
+    barrier();
+    total = sTotal;
+    return sScratch[gl_SubgroupID] + inclusive - value;
+#else
+    sScratch[id] = value;
+    barrier();
+    for (uint offset = 1; offset < GROUP_SIZE; offset <<= 1)
+    {
+        const uint add = id >= offset ? sScratch[id - offset] : 0;
+        barrier();
+        sScratch[id] += add;
+        barrier();
+    }
+    total = sScratch[GROUP_SIZE - 1];
+    return sScratch[id] - value;
+#endif
+}
+
+const uint ReduceSum = 0;
+const uint ReduceMin = 1;
+const uint ReduceMax = 2;
+
+uint ReduceIdentity(uint op)
+{
+    return op == ReduceMin ? 0xFFFFFFFFu : 0u;
+}
+
+uint Combine(uint a, uint b, uint op)
+{
+    if (op == ReduceMin)
+    {
+        return min(a, b);
+    }
+    if (op == ReduceMax)
+    {
+        return max(a, b);
+    }
+    return a + b;
+}
+
+// The result is only valid in invocation 0. Must be called in uniform
+// control flow
+uint WorkgroupReduce(uint value, uint op)
+{
+    const uint id = gl_LocalInvocationID.x;
+    barrier();
+#ifdef SWIFT_SUBGROUP
+    uint reduced;
+    if (op == ReduceMin)
+    {
+        reduced = subgroupMin(value);
+    }
+    else if (op == ReduceMax)
+    {
+        reduced = subgroupMax(value);
+    }
+    else
+    {
+        reduced = subgroupAdd(value);
+    }
+    if (subgroupElect())
+    {
+        sScratch[gl_SubgroupID] = reduced;
+    }
+    barrier();
+    if (id == 0)
+    {
+        for (uint i = 1; i < gl_NumSubgroups; ++i)
+        {
+            reduced = Combine(reduced, sScratch[i], op);
+        }
+    }
+    return reduced;
+#else
+    sScratch[id] = value;
+    barrier();
+    for (uint stride = GROUP_SIZE / 2; stride > 0; stride >>= 1)
+    {
+        if (id < stride)
+        {
+            sScratch[id] = Combine(sScratch[id], sScratch[id + stride], op);
+        }
+        barrier();
+    }
+    return sScratch[0];
+#endif
+}
@@ -0,0 +1,613 @@
+#include "SwiftCompute.hpp"
+#include "Swift.hpp"
+#include "SwiftInternal.hpp"
+#include "algorithm"
+#include "array"
+#include "utility"
+
+using namespace Swift;
+
+namespace
+{
+    constexpr uint32_t gDispatchArgsCode[] =
+#include "DispatchArgs.comp.inc"
+        ;
+    constexpr uint32_t gScanCode[] =
+#include "Scan.comp.inc"
+        ;
+    constexpr uint32_t gScanSubgroupCode[] =
+#include "Scan.comp.subgroup.inc"
+        ;
+    constexpr uint32_t gScanAddCode[] =
+#include "ScanAdd.comp.inc"
+        ;
+    constexpr uint32_t gScanAddSubgroupCode[] =
+#include "ScanAdd.comp.subgroup.inc"
+        ;
+    constexpr uint32_t gCompactCode[] =
+#include "Compact.comp.inc"
+        ;
+    constexpr uint32_t gCompactSubgroupCode[] =
+#include "Compact.comp.subgroup.inc"
+        ;
+    constexpr uint32_t gRadixHistogramCode[] =
+#include "RadixHistogram.comp.inc"
+        ;
+    constexpr uint32_t gRadixHistogramSubgroupCode[] =
+#include "RadixHistogram.comp.subgroup.inc"
+        ;
+    constexpr uint32_t gRadixScatterCode[] =
+#include "RadixScatter.comp.inc"
+        ;
+    constexpr uint32_t gRadixScatterSubgroupCode[] =
+#include "RadixScatter.comp.subgroup.inc"
+        ;
+    constexpr uint32_t gReduceCode[] =
+#include "Reduce.comp.inc"
+        ;
+    constexpr uint32_t gReduceSubgroupCode[] =
+#include "Reduce.comp.subgroup.inc"
+        ;
+    constexpr uint32_t gHistogramCode[] =
+#include "Histogram.comp.inc"
+        ;
+    constexpr uint32_t gHistogramSubgroupCode[] =
+#include "Histogram.comp.subgroup.inc"
+        ;
+
+    // Matches Shaders/Primitives/Common.glsl
+    constexpr uint32_t gBlockSize = 1024;
+    constexpr uint32_t gRadixBits = 4;
+    constexpr uint32_t gRadix = 1 << gRadixBits;
+
+    struct DispatchArgsPushConstant
+    {
+        uint64_t Count;
+        uint64_t Args;
+        uint32_t GroupSize;
+        uint32_t MaxGroupCount;
+    };
+
+    struct ScanPushConstant
+    {
+        uint64_t Input;
+        uint64_t Output;
+        uint64_t BlockSums;
+        uint32_t Count;
+        uint32_t Inclusive;
+        uint32_t WriteBlockSums;
+    };
+
+    struct ScanAddPushConstant
+    {
+        uint64_t Output;
+        uint64_t BlockOffsets;
+        uint32_t Count;
+    };
+
+    struct CompactPushConstant
+    {
+        uint64_t Input;
+        uint64_t Flags;
+        uint64_t Indices;
+        uint64_t Output;
+        uint64_t OutputCount;
+        uint32_t Count;
+    };
+
+    struct RadixHistogramPushConstant
+    {
+        uint64_t Keys;
+        uint64_t Histogram;
+        uint32_t Count;
+        uint32_t Shift;
+        uint32_t BlockCount;
+    };
+
+    struct RadixScatterPushConstant
+    {
+        uint64_t KeysIn;
+        uint64_t ValuesIn;
+        uint64_t KeysOut;
+        uint64_t ValuesOut;
+        uint64_t Offsets;
+        uint32_t Count;
+        uint32_t Shift;
+        uint32_t BlockCount;
+        uint32_t HasValues;
+    };
+
+    struct ReducePushConstant
+    {
+        uint64_t Input;
+        uint64_t Result;
+        uint32_t Count;
+        uint32_t Op;
+    };
+
+    struct HistogramPushConstant
+    {
+        uint64_t Input;
+        uint64_t Bins;
+        uint32_t Count;
+        uint32_t BinCount;
+        uint32_t Shift;
+    };
+
+    ShaderHandle gDispatchArgsShader = InvalidHandle;
+    ShaderHandle gScanShader = InvalidHandle;
+    ShaderHandle gScanAddShader = InvalidHandle;
+    ShaderHandle gCompactShader = InvalidHandle;
+    ShaderHandle gRadixHistogramShader = InvalidHandle;
+    ShaderHandle gRadixScatterShader = InvalidHandle;
+    ShaderHandle gReduceShader = InvalidHandle;
+    ShaderHandle gHistogramShader = InvalidHandle;
+
+    // An address into a buffer that keeps the handle for hazard tracking
+    struct BufferRange
+    {
+        BufferHandle Buffer = InvalidHandle;
+        uint64_t Offset = 0;
+    };
+
+    uint64_t GetAddress(const BufferRange& range)
+    {
+        if (range.Buffer == InvalidHandle)
+        {
+            return 0;
+        }
+        return GetBufferAddress(range.Buffer) + range.Offset;
+    }
+
+    // The scratch holds a second set of keys and values for the sort, which
+    // compaction reuses for its indices, then the sort's block histograms and
+    // the block sums of every scan level
+    struct ScratchLayout
+    {
+        uint64_t ValuesOffset;
+        uint64_t HistogramOffset;
+        uint64_t LevelsOffset;
+        uint64_t Size;
+    };
+
+    uint64_t AlignScratch(const uint64_t size) { return (size + 15) & ~15ull; }
+
+    uint32_t GetBlockCount(const uint32_t count)
+    {
+        return (count + gBlockSize - 1) / gBlockSize;
+    }
+
+    uint64_t GetScanLevelsSize(uint32_t count)
+    {
+        uint64_t size = 0;
+        while (count > gBlockSize)
+        {
+            count = GetBlockCount(count);
+            size += AlignScratch(count * sizeof(uint32_t));
+        }
+        return size;
+    }
+
+    ScratchLayout GetScratchLayout(const uint32_t maxCount)
+    {
+        const uint64_t elementsSize =
+            AlignScratch(uint64_t{maxCount} * sizeof(uint32_t));
+        const uint32_t histogramCount = gRadix * GetBlockCount(maxCount);
+        ScratchLayout layout{
+            .ValuesOffset = elementsSize,
+            .HistogramOffset = 2 * elementsSize,
+        };
+        layout.LevelsOffset =
+            layout.HistogramOffset +
+            AlignScratch(histogramCount * sizeof(uint32_t));
+        layout.Size = layout.LevelsOffset +
+                      GetScanLevelsSize(std::max(maxCount, histogramCount));
+        return layout;
+    }
+
+    template <size_t N, size_t M>
+    std::expected<ShaderHandle,
+                  Error>
+    CreatePrimitiveShader(const uint32_t (&code)[N],
+                          const uint32_t (&subgroupCode)[M])
+    {
+        const bool subgroup = GetContext().Features.SubgroupArithmetic;
+        const ComputeShaderCreateInfo createInfo{
+            .ComputeCode = subgroup ? GetEmbeddedShaderCode(subgroupCode)
+                                    : GetEmbeddedShaderCode(code),
+        };
+        return CreateComputeShader(createInfo);
+    }
+
+    void TransitionForCompute(const std::initializer_list<BufferHandle> reads,
+                              const std::initializer_list<BufferHandle> writes)
+    {
+        std::vector<BufferTransition> transitions;
+        for (const auto buffer : reads)
+        {
+            if (buffer != InvalidHandle)
+            {
+                transitions.push_back({
+                    .Buffer = buffer,
+                    .Stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    .Access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+                });
+            }
+        }
+        for (const auto buffer : writes)
+        {
+            if (buffer != InvalidHandle)
+            {
+                transitions.push_back({
+                    .Buffer = buffer,
+                    .Stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    .Access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+                              VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                });
+            }
+        }
+        TransitionBuffers(transitions);
+    }
+
+    // Scans block by block, then scans the block sums one level up and adds
+    // them back when there was more than one block
+    void RecordScan(const BufferRange& input,
+                    const BufferRange& output,
+                    const uint32_t count,
+                    const bool inclusive,
+                    const BufferRange& levels)
+    {
+        const uint32_t blockCount = GetBlockCount(count);
+        const bool multiLevel = blockCount > 1;
+        TransitionForCompute({input.Buffer},
+                             {output.Buffer,
+                              multiLevel ? levels.Buffer : InvalidHandle});
+        BindShader(gScanShader);
+        const ScanPushConstant scanPushConstant{
+            .Input = GetAddress(input),
+            .Output = GetAddress(output),
+            .BlockSums = GetAddress(levels),
+            .Count = count,
+            .Inclusive = inclusive,
+            .WriteBlockSums = multiLevel,
+        };
+        PushConstant(scanPushConstant);
+        DispatchCompute(blockCount, 1, 1);
+        if (!multiLevel)
+        {
+            return;
+        }
+
+        const BufferRange nextLevels{
+            .Buffer = levels.Buffer,
+            .Offset = levels.Offset +
+                      AlignScratch(blockCount * sizeof(uint32_t)),
+        };
+        RecordScan(levels, levels, blockCount, false, nextLevels);
+
+        TransitionForCompute({levels.Buffer}, {output.Buffer});
+        BindShader(gScanAddShader);
+        const ScanAddPushConstant addPushConstant{
+            .Output = GetAddress(output),
+            .BlockOffsets = GetAddress(levels),
+            .Count = count,
+        };
+        PushConstant(addPushConstant);
+        DispatchCompute(blockCount, 1, 1);
+    }
+} // namespace
+
+std::expected<void,
+              Error>
+Swift::InitCompute()
+{
+    const ComputeShaderCreateInfo createInfo{
+        .ComputeCode = GetEmbeddedShaderCode(gDispatchArgsCode),
+    };
+    const auto shaderResult = CreateComputeShader(createInfo);
+    if (!shaderResult)
+    {
+        return std::unexpected(shaderResult.error());
+    }
+    gDispatchArgsShader = shaderResult.value();
+
+    const std::array primitives{
+        std::pair{&gScanShader,
+                  CreatePrimitiveShader(gScanCode, gScanSubgroupCode)},
+        std::pair{&gScanAddShader,
+                  CreatePrimitiveShader(gScanAddCode, gScanAddSubgroupCode)},
+        std::pair{&gCompactShader,
+                  CreatePrimitiveShader(gCompactCode, gCompactSubgroupCode)},
+        std::pair{&gRadixHistogramShader,
+                  CreatePrimitiveShader(gRadixHistogramCode,
+                                        gRadixHistogramSubgroupCode)},
+        std::pair{&gRadixScatterShader,
+                  CreatePrimitiveShader(gRadixScatterCode,
+                                        gRadixScatterSubgroupCode)},
+        std::pair{&gReduceShader,
+                  CreatePrimitiveShader(gReduceCode, gReduceSubgroupCode)},
+        std::pair{&gHistogramShader,
+                  CreatePrimitiveShader(gHistogramCode,
+                                        gHistogramSubgroupCode)},
+    };
+    for (const auto& [shader, result] : primitives)
+    {
+        if (!result)
+        {
+            return std::unexpected(result.error());
+        }
+        *shader = result.value();
+    }
+    return {};
+}
+
+std::expected<void,
+              Error>
+Swift::WriteDispatchArgs(const BufferHandle countBuffer,
+                         const uint64_t countOffset,
+                         const BufferHandle argsBuffer,
+                         const uint64_t argsOffset,
+                         const ShaderHandle consumer)
+{
+    // The shader divides by the group size
+    const uint32_t groupSize = GetShaderReflection(consumer).LocalSize[0];
+    if (groupSize == 0)
+    {
+        return std::unexpected(Error::eInvalidArgument);
+    }
+
+    const std::array<BufferTransition, 2> transitions{{
+        {
+            .Buffer = countBuffer,
+            .Stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .Access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+        },
+        {
+            .Buffer = argsBuffer,
+            .Stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .Access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        },
+    }};
+    TransitionBuffers(transitions);
+
+    const auto& limits = GetContext().GPU.properties.limits;
+    BindShader(gDispatchArgsShader);
+    const DispatchArgsPushConstant pushConstant{
+        .Count = GetBufferAddress(countBuffer) + countOffset,
+        .Args = GetBufferAddress(argsBuffer) + argsOffset,
+        .GroupSize = groupSize,
+        .MaxGroupCount = limits.maxComputeWorkGroupCount[0],
+    };
+    PushConstant(pushConstant);
+    DispatchCompute(1, 1, 1);
+    return {};
+}
+
+std::expected<ComputeScratch,
+              Error>
+Swift::CreateComputeScratch(const uint32_t maxCount)
+{
+    const BufferCreateInfo createInfo{
+        .Usage = BufferUsage::eStorage,
+        .Size = std::max(GetScratchLayout(maxCount).Size, uint64_t{16}),
+    };
+    const auto bufferResult = CreateBuffer(createInfo);
+    if (!bufferResult)
+    {
+        return std::unexpected(bufferResult.error());
+    }
+    return ComputeScratch{
+        .Buffer = bufferResult.value(),
+        .MaxCount = maxCount,
+    };
+}
+
+void Swift::DestroyComputeScratch(const ComputeScratch& scratch)
+{
+    DestroyBuffer(scratch.Buffer);
+}
+
+std::expected<void,
+              Error>
+Swift::PrefixSum(const BufferHandle input,
+                 const BufferHandle output,
+                 const uint32_t count,
+                 const ComputeScratch& scratch,
+                 const ScanType type)
+{
+    if (count > scratch.MaxCount)
+    {
+        return std::unexpected(Error::eInvalidArgument);
+    }
+    if (count == 0)
+    {
+        return {};
+    }
+    const auto layout = GetScratchLayout(scratch.MaxCount);
+    RecordScan({.Buffer = input},
+               {.Buffer = output},
+               count,
+               type == ScanType::eInclusive,
+               {.Buffer = scratch.Buffer, .Offset = layout.LevelsOffset});
+    return {};
+}
+
+std::expected<void,
+              Error>
+Swift::Compact(const BufferHandle input,
+               const BufferHandle flags,
+               const BufferHandle output,
+               const BufferHandle outputCount,
+               const uint32_t count,
+               const ComputeScratch& scratch)
+{
+    if (count > scratch.MaxCount)
+    {
+        return std::unexpected(Error::eInvalidArgument);
+    }
+    if (count == 0)
+    {
+        FillBuffer(outputCount, 0, 0, sizeof(uint32_t));
+        return {};
+    }
+    const auto layout = GetScratchLayout(scratch.MaxCount);
+    const BufferRange indices{.Buffer = scratch.Buffer};
+    RecordScan({.Buffer = flags},
+               indices,
+               count,
+               false,
+               {.Buffer = scratch.Buffer, .Offset = layout.LevelsOffset});
+
+    TransitionForCompute({input, flags, scratch.Buffer}, {output, outputCount});
+    BindShader(gCompactShader);
+    const CompactPushConstant pushConstant{
+        .Input = GetBufferAddress(input),
+        .Flags = GetBufferAddress(flags),
+        .Indices = GetAddress(indices),
+        .Output = GetBufferAddress(output),
+        .OutputCount = GetBufferAddress(outputCount),
+        .Count = count,
+    };
+    PushConstant(pushConstant);
+    DispatchCompute(GetBlockCount(count), 1, 1);
+    return {};
+}
+
+std::expected<void,
+              Error>
+Swift::RadixSort(const BufferHandle keys,
+                 const BufferHandle values,
+                 const uint32_t count,
+                 const ComputeScratch& scratch,
+                 const uint32_t keyBits)
+{
+    if (count > scratch.MaxCount)
+    {
+        return std::unexpected(Error::eInvalidArgument);
+    }
+    if (count == 0)
+    {
+        return {};
+    }
+    const auto layout = GetScratchLayout(scratch.MaxCount);
+    const uint32_t blockCount = GetBlockCount(count);
+    const bool hasValues = values != InvalidHandle;
+    const BufferRange histogram{
+        .Buffer = scratch.Buffer,
+        .Offset = layout.HistogramOffset,
+    };
+    const BufferRange levels{
+        .Buffer = scratch.Buffer,
+        .Offset = layout.LevelsOffset,
+    };
+
+    BufferRange keysIn{.Buffer = keys};
+    BufferRange valuesIn{.Buffer = values};
+    BufferRange keysOut{.Buffer = scratch.Buffer};
+    BufferRange valuesOut{
+        .Buffer = hasValues ? scratch.Buffer : InvalidHandle,
+        .Offset = layout.ValuesOffset,
+    };
+
+    const uint32_t passCount = (keyBits + gRadixBits - 1) / gRadixBits;
+    for (uint32_t pass = 0; pass < passCount; ++pass)
+    {
+        const uint32_t shift = pass * gRadixBits;
+        TransitionForCompute({keysIn.Buffer}, {scratch.Buffer});
+        BindShader(gRadixHistogramShader);
+        const RadixHistogramPushConstant histogramPushConstant{
+            .Keys = GetAddress(keysIn),
+            .Histogram = GetAddress(histogram),
+            .Count = count,
+            .Shift = shift,
+            .BlockCount = blockCount,
+        };
+        PushConstant(histogramPushConstant);
+        DispatchCompute(blockCount, 1, 1);
+
+        RecordScan(histogram, histogram, gRadix * blockCount, false, levels);
+
+        TransitionForCompute({keysIn.Buffer, valuesIn.Buffer},
+                             {keysOut.Buffer, valuesOut.Buffer});
+        BindShader(gRadixScatterShader);
+        const RadixScatterPushConstant scatterPushConstant{
+            .KeysIn = GetAddress(keysIn),
+            .ValuesIn = GetAddress(valuesIn),
+            .KeysOut = GetAddress(keysOut),
+            .ValuesOut = GetAddress(valuesOut),
+            .Offsets = GetAddress(histogram),
+            .Count = count,
+            .Shift = shift,
+            .BlockCount = blockCount,
+            .HasValues = hasValues,
+        };
+        PushConstant(scatterPushConstant);
+        DispatchCompute(blockCount, 1, 1);
+
+        std::swap(keysIn, keysOut);
+        std::swap(valuesIn, valuesOut);
+    }
+
+    // An odd pass count leaves the result in the scratch
+    if (keysIn.Buffer != keys)
+    {
+        const uint64_t size = uint64_t{count} * sizeof(uint32_t);
+        CopyBuffer(scratch.Buffer, keys, {{0, 0, size}});
+        if (hasValues)
+        {
+            CopyBuffer(scratch.Buffer,
+                       values,
+                       {{layout.ValuesOffset, 0, size}});
+        }
+    }
+    return {};
+}
+
+void Swift::Reduce(const BufferHandle input,
+                   const BufferHandle result,
+                   const uint32_t count,
+                   const ReduceOp op)
+{
+    const uint32_t identity = op == ReduceOp::eMin ? UINT32_MAX : 0;
+    FillBuffer(result, identity, 0, sizeof(uint32_t));
+    if (count == 0)
+    {
+        return;
+    }
+
+    TransitionForCompute({input}, {result});
+    BindShader(gReduceShader);
+    const ReducePushConstant pushConstant{
+        .Input = GetBufferAddress(input),
+        .Result = GetBufferAddress(result),
+        .Count = count,
+        .Op = static_cast<uint32_t>(op),
+    };
+    PushConstant(pushConstant);
+    DispatchCompute(GetBlockCount(count), 1, 1);
+}
+
+void Swift::Histogram(const BufferHandle input,
+                      const BufferHandle bins,
+                      const uint32_t count,
+                      const uint32_t binCount,
+                      const uint32_t shift)
+{
+    FillBuffer(bins, 0, 0, uint64_t{binCount} * sizeof(uint32_t));
+    if (count == 0)
+    {
+        return;
+    }
+
+    TransitionForCompute({input}, {bins});
+    BindShader(gHistogramShader);
+    const HistogramPushConstant pushConstant{
+        .Input = GetBufferAddress(input),
+        .Bins = GetBufferAddress(bins),
+        .Count = count,
+        .BinCount = binCount,
+        .Shift = shift,
+    };
+    PushConstant(pushConstant);
+    DispatchCompute(GetBlockCount(count), 1, 1);
+}
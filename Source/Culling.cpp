@@ -0,0 +1,357 @@
+#include "SwiftCulling.hpp"
+#include "Swift.hpp"
+#include "SwiftInternal.hpp"
+#include "Vulkan/VulkanUtil.hpp"
+
+using namespace Swift;
+
+namespace
+{
+    constexpr uint32_t gCullingCode[] =
+#include "Culling.comp.inc"
+        ;
+    constexpr uint32_t gDepthReduceCode[] =
+#include "DepthReduce.comp.inc"
+        ;
+    constexpr uint32_t gCullGroupSize = 64;
+    constexpr uint32_t gReduceGroupSize = 16;
+
+    struct CullPushConstant
+    {
+        uint64_t Instances;
+        uint64_t View;
+        uint64_t Commands;
+        uint64_t Count;
+        uint64_t Visibility;
+        uint32_t InstanceCount;
+        uint32_t MaxDraws;
+        uint32_t Phase;
+        uint32_t PyramidIndex;
+        uint32_t PyramidWidth;
+        uint32_t PyramidHeight;
+        uint32_t PyramidMipCount;
+        uint32_t ReverseZ;
+    };
+
+    struct ReducePushConstant
+    {
+        uint32_t SourceIndex;
+        uint32_t DestIndex;
+        uint32_t DestWidth;
+        uint32_t DestHeight;
+        uint32_t UseMinmax;
+        uint32_t ReverseZ;
+    };
+
+    ShaderHandle gCullShader = InvalidHandle;
+    ShaderHandle gDepthReduceShader = InvalidHandle;
+
+    int PreviousPowerOfTwo(const int value)
+    {
+        int result = 1;
+        while (result * 2 <= value)
+        {
+            result *= 2;
+        }
+        return result;
+    }
+} // namespace
+
+std::expected<void,
+              Error>
+Swift::InitCulling()
+{
+    // Culled draws carry their instance index in FirstInstance
+    if (!GetContext().Features.DrawIndirectFirstInstance)
+    {
+        return std::unexpected(Error::eFeatureNotSupported);
+    }
+    const ComputeShaderCreateInfo createInfo{
+        .ComputeCode = GetEmbeddedShaderCode(gCullingCode),
+    };
+    const auto shaderResult = CreateComputeShader(createInfo);
+    if (!shaderResult)
+    {
+        return std::unexpected(shaderResult.error());
+    }
+    gCullShader = shaderResult.value();
+
+    const ComputeShaderCreateInfo reduceCreateInfo{
+        .ComputeCode = GetEmbeddedShaderCode(gDepthReduceCode),
+    };
+    const auto reduceResult = CreateComputeShader(reduceCreateInfo);
+    if (!reduceResult)
+    {
+        return std::unexpected(reduceResult.error());
+    }
+    gDepthReduceShader = reduceResult.value();
+    return {};
+}
+
+std::expected<DepthPyramid,
+              Error>
+Swift::CreateDepthPyramid(const Int2 depthExtent,
+                          const bool reverseZ)
+{
+    const Int2 extent{PreviousPowerOfTwo(depthExtent.x),
+                      PreviousPowerOfTwo(depthExtent.y)};
+    uint32_t mipLevels = 1;
+    while ((std::max(extent.x, extent.y) >> mipLevels) > 0)
+    {
+        ++mipLevels;
+    }
+
+    // With min/max filtering a single bilinear tap reduces the whole 2x2
+    // footprint, otherwise the shader fetches and reduces every texel
+    SamplerCreateInfo samplerCreateInfo{
+        .MinFilter = VK_FILTER_NEAREST,
+        .MagFilter = VK_FILTER_NEAREST,
+        .MipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .AddressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .AddressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .AddressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+    };
+    if (GetContext().Features.SamplerFilterMinmax)
+    {
+        samplerCreateInfo.MinFilter = VK_FILTER_LINEAR;
+        samplerCreateInfo.MagFilter = VK_FILTER_LINEAR;
+        samplerCreateInfo.ReductionMode = reverseZ
+                                              ? VK_SAMPLER_REDUCTION_MODE_MIN
+                                              : VK_SAMPLER_REDUCTION_MODE_MAX;
+    }
+    const auto samplerResult = CreateSampler(samplerCreateInfo);
+    if (!samplerResult)
+    {
+        return std::unexpected(samplerResult.error());
+    }
+
+    const ImageCreateInfo imageCreateInfo{
+        .Format = VK_FORMAT_R32_SFLOAT,
+        .Extent = extent,
+        .Usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .Sampler = samplerResult.value(),
+        .MipLevels = mipLevels,
+    };
+    const auto imageResult = CreateImage(imageCreateInfo);
+    if (!imageResult)
+    {
+        return std::unexpected(imageResult.error());
+    }
+
+    DepthPyramid pyramid{
+        .Image = imageResult.value(),
+        .Extent = extent,
+        .ReverseZ = reverseZ,
+    };
+    const auto fullViewResult = CreateImageView(pyramid.Image, 0, mipLevels);
+    if (!fullViewResult)
+    {
+        DestroyImage(pyramid.Image);
+        return std::unexpected(fullViewResult.error());
+    }
+    pyramid.FullView = fullViewResult.value();
+
+    for (uint32_t mip = 0; mip < mipLevels; ++mip)
+    {
+        const auto mipViewResult = CreateImageView(pyramid.Image, mip);
+        if (!mipViewResult)
+        {
+            DestroyDepthPyramid(pyramid);
+            return std::unexpected(mipViewResult.error());
+        }
+        pyramid.MipViews.emplace_back(mipViewResult.value());
+    }
+    return pyramid;
+}
+
+void Swift::DestroyDepthPyramid(const DepthPyramid& pyramid)
+{
+    for (const auto mipView : pyramid.MipViews)
+    {
+        DestroyImage(mipView);
+    }
+    DestroyImage(pyramid.FullView);
+    DestroyImage(pyramid.Image);
+}
+
+void Swift::BuildDepthPyramid(const DepthPyramid& pyramid,
+                              const ImageHandle depthImage)
+{
+    const auto commandBuffer = GetGraphicsCommand().Buffer;
+    TransitionImage(depthImage,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    VK_IMAGE_ASPECT_DEPTH_BIT);
+    // Also orders the rewrite after last frame's culling reads
+    TransitionImage(pyramid.Image, VK_IMAGE_LAYOUT_GENERAL);
+
+    const bool useMinmax = GetContext().Features.SamplerFilterMinmax;
+    BindShader(gDepthReduceShader);
+    for (uint32_t mip = 0; mip < pyramid.MipViews.size(); ++mip)
+    {
+        const uint32_t width = std::max(pyramid.Extent.x >> mip, 1);
+        const uint32_t height = std::max(pyramid.Extent.y >> mip, 1);
+        // The first level is not an exact 2x2 reduction of the depth image,
+        // and its sampler is not a reduction sampler, so it always fetches
+        // the whole footprint
+        const ReducePushConstant pushConstant{
+            .SourceIndex = mip == 0 ? depthImage : pyramid.MipViews[mip - 1],
+            .DestIndex = pyramid.MipViews[mip],
+            .DestWidth = width,
+            .DestHeight = height,
+            .UseMinmax = mip != 0 && useMinmax,
+            .ReverseZ = pyramid.ReverseZ,
+        };
+        PushConstant(pushConstant);
+        DispatchCompute((width + gReduceGroupSize - 1) / gReduceGroupSize,
+                        (height + gReduceGroupSize - 1) / gReduceGroupSize,
+                        1);
+        Vulkan::GlobalBarrier(commandBuffer,
+                              VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                              VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                              VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                              VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+    }
+}
+
+std::expected<CullOutput,
+              Error>
+Swift::CreateCullOutput(const uint32_t maxDraws)
+{
+    const BufferCreateInfo commandsCreateInfo{
+        .Usage = BufferUsage::eIndirect,
+        .Size = maxDraws * sizeof(VkDrawIndexedIndirectCommand),
+    };
+    const auto commandsResult = CreateBuffer(commandsCreateInfo);
+    if (!commandsResult)
+    {
+        return std::unexpected(commandsResult.error());
+    }
+
+    const BufferCreateInfo countCreateInfo{
+        .Usage = BufferUsage::eIndirect,
+        .Size = sizeof(uint32_t),
+    };
+    const auto countResult = CreateBuffer(countCreateInfo);
+    if (!countResult)
+    {
+        DestroyBuffer(commandsResult.value());
+        return std::unexpected(countResult.error());
+    }
+
+    return CullOutput{
+        .Commands = commandsResult.value(),
+        .Count = countResult.value(),
+        .MaxDraws = maxDraws,
+    };
+}
+
+void Swift::DestroyCullOutput(const CullOutput& output)
+{
+    DestroyBuffer(output.Commands);
+    DestroyBuffer(output.Count);
+}
+
+std::expected<void,
+              Error>
+Swift::CullInstances(const BufferHandle instanceBuffer,
+                     const uint32_t instanceCount,
+                     const CullView& view,
+                     const CullOutput& output,
+                     const OcclusionCullInfo& occlusion)
+{
+    const auto viewResult = AllocateTransient(view);
+    if (!viewResult)
+    {
+        return std::unexpected(viewResult.error());
+    }
+
+    // Resetting the count waits on earlier indirect draws reading it
+    constexpr uint32_t zero = 0;
+    UpdateBuffer(output.Count, &zero, 0, sizeof(zero));
+
+    std::vector<BufferTransition> transitions{
+        {
+            .Buffer = instanceBuffer,
+            .Stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .Access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+        },
+        {
+            .Buffer = output.Commands,
+            .Stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .Access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        },
+        {
+            .Buffer = output.Count,
+            .Stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .Access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+                      VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        },
+    };
+    if (occlusion.Phase != CullPhase::eFrustum)
+    {
+        transitions.push_back({
+            .Buffer = occlusion.Visibility,
+            .Stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .Access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+                      VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        });
+    }
+    TransitionBuffers(transitions);
+
+    BindShader(gCullShader);
+    CullPushConstant pushConstant{
+        .Instances = GetBufferAddress(instanceBuffer),
+        .View = viewResult->Address,
+        .Commands = GetBufferAddress(output.Commands),
+        .Count = GetBufferAddress(output.Count),
+        .InstanceCount = instanceCount,
+        .MaxDraws = output.MaxDraws,
+        .Phase = static_cast<uint32_t>(occlusion.Phase),
+    };
+    if (occlusion.Phase != CullPhase::eFrustum)
+    {
+        pushConstant.Visibility = GetBufferAddress(occlusion.Visibility);
+    }
+    if (occlusion.Phase == CullPhase::eLate)
+    {
+        const auto& pyramid = *occlusion.Pyramid;
+        pushConstant.PyramidIndex = pyramid.FullView;
+        pushConstant.PyramidWidth = pyramid.Extent.x;
+        pushConstant.PyramidHeight = pyramid.Extent.y;
+        pushConstant.PyramidMipCount =
+            static_cast<uint32_t>(pyramid.MipViews.size());
+        pushConstant.ReverseZ = pyramid.ReverseZ;
+    }
+    PushConstant(pushConstant);
+    DispatchCompute((instanceCount + gCullGroupSize - 1) / gCullGroupSize,
+                    1,
+                    1);
+
+    // DrawCulled runs inside rendering where it cannot record barriers
+    const std::array<BufferTransition, 2> drawTransitions{{
+        {
+            .Buffer = output.Commands,
+            .Stage = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+            .Access = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+        },
+        {
+            .Buffer = output.Count,
+            .Stage = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+            .Access = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+        },
+    }};
+    TransitionBuffers(drawTransitions);
+    return {};
+}
+
+std::expected<void,
+              Error>
+Swift::DrawCulled(const CullOutput& output)
+{
+    return DrawIndexedIndirectCount(output.Commands,
+                                    0,
+                                    output.Count,
+                                    0,
+                                    output.MaxDraws,
+                                    sizeof(VkDrawIndexedIndirectCommand));
+}
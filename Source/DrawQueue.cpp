@@ -0,0 +1,141 @@
+#include "SwiftDrawQueue.hpp"
+#include "Swift.hpp"
+#include "SwiftInternal.hpp"
+#include "algorithm"
+#include "array"
+
+using namespace Swift;
+
+namespace
+{
+    constexpr uint64_t gShaderBits = 15;
+    constexpr uint64_t gMaterialBits = 16;
+
+    // Non negative floats order the same as their bits
+    uint32_t GetDepthBits(const float depth)
+    {
+        return std::bit_cast<uint32_t>(std::max(depth, 0.f));
+    }
+
+    uint64_t GetSortKey(const DrawPacket& packet)
+    {
+        const uint64_t shader = packet.Shader & ((1ull << gShaderBits) - 1);
+        const uint64_t material =
+            packet.Material & ((1ull << gMaterialBits) - 1);
+        const uint64_t depth = GetDepthBits(packet.Depth);
+        if (packet.Transparent)
+        {
+            // Inverted so the farthest draw sorts first
+            return 1ull << 63 | (~depth & 0xFFFFFFFFull) << 31 |
+                   shader << gMaterialBits | material;
+        }
+        return shader << 48 | material << 32 | depth;
+    }
+
+    // LSD radix sort on bytes, skipping the bytes every key shares, which
+    // for a typical frame is most of them
+    void SortEntries(std::vector<DrawQueue::Entry>& entries,
+                     std::vector<DrawQueue::Entry>& scratch)
+    {
+        scratch.resize(entries.size());
+        for (uint32_t shift = 0; shift < 64; shift += 8)
+        {
+            std::array<uint32_t, 256> counts{};
+            for (const auto& entry : entries)
+            {
+                ++counts[(entry.Key >> shift) & 0xFF];
+            }
+            if (std::ranges::find(counts, entries.size()) != counts.end())
+            {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for (auto& count : counts)
+            {
+                const uint32_t binCount = count;
+                count = offset;
+                offset += binCount;
+            }
+            for (const auto& entry : entries)
+            {
+                scratch[counts[(entry.Key >> shift) & 0xFF]++] = entry;
+            }
+            entries.swap(scratch);
+        }
+    }
+} // namespace
+
+void Swift::PushDraw(DrawQueue& queue,
+                     const DrawPacket& packet,
+                     const void* pushData,
+                     const uint32_t pushSize)
+{
+    const auto pushOffset = static_cast<uint32_t>(queue.PushData.size());
+    if (pushSize > 0)
+    {
+        queue.PushData.resize(pushOffset + pushSize);
+        std::memcpy(queue.PushData.data() + pushOffset, pushData, pushSize);
+    }
+    queue.Entries.push_back({
+        .Key = GetSortKey(packet),
+        .Packet = static_cast<uint32_t>(queue.Packets.size()),
+    });
+    queue.Packets.push_back({
+        .Packet = packet,
+        .PushOffset = pushOffset,
+        .PushSize = pushSize,
+    });
+}
+
+std::expected<void,
+              Error>
+Swift::SubmitDrawQueue(DrawQueue& queue)
+{
+    SortEntries(queue.Entries, queue.SortScratch);
+
+    BufferHandle indexBuffer = InvalidHandle;
+    IndexType indexType = IndexType::eUint32;
+    bool indexBound = false;
+    std::expected<void,
+                  Error>
+        result;
+    for (const auto& entry : queue.Entries)
+    {
+        const auto& [packet, pushOffset, pushSize] =
+            queue.Packets[entry.Packet];
+        BindShader(packet.Shader);
+        // FirstIndex is relative to the start of the slice's buffer, so
+        // meshes packed into the same pool block share one bind
+        if (packet.Mesh.Slice.Buffer != indexBuffer ||
+            packet.Mesh.Type != indexType)
+        {
+            indexBuffer = packet.Mesh.Slice.Buffer;
+            indexType = packet.Mesh.Type;
+            const auto bindResult =
+                BindIndexBuffer(indexBuffer, 0, indexType);
+            indexBound = bindResult.has_value();
+            if (!bindResult) result = bindResult;
+        }
+        // Drawing would read the previous index buffer
+        if (!indexBound) continue;
+        if (pushSize > 0)
+        {
+            PushConstant(queue.PushData.data() + pushOffset, pushSize, 0);
+        }
+        DrawIndexed(packet.Mesh.IndexCount,
+                    packet.InstanceCount,
+                    packet.Mesh.FirstIndex,
+                    packet.VertexOffset,
+                    packet.FirstInstance);
+    }
+    ClearDrawQueue(queue);
+    return result;
+}
+
+void Swift::ClearDrawQueue(DrawQueue& queue)
+{
+    queue.Packets.clear();
+    queue.Entries.clear();
+    queue.PushData.clear();
+}
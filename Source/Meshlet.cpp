@@ -0,0 +1,292 @@
+#include "SwiftMeshlet.hpp"
+#include "Swift.hpp"
+#include "algorithm"
+#include "array"
+#include "atomic"
+#include "cmath"
+#include "cstring"
+#include "thread"
+
+using namespace Swift;
+
+namespace
+{
+    using Vec3 = std::array<float, 3>;
+
+    Vec3 Sub(const Vec3& a,
+             const Vec3& b)
+    {
+        return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+    }
+
+    float Dot(const Vec3& a,
+              const Vec3& b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    Vec3 Cross(const Vec3& a,
+               const Vec3& b)
+    {
+        return {a[1] * b[2] - a[2] * b[1],
+                a[2] * b[0] - a[0] * b[2],
+                a[0] * b[1] - a[1] * b[0]};
+    }
+
+    Vec3 Normalize(const Vec3& v)
+    {
+        const float length = std::sqrt(Dot(v, v));
+        if (length == 0.f) return v;
+        return {v[0] / length, v[1] / length, v[2] / length};
+    }
+
+    Vec3 GetPosition(const MeshletSource& source,
+                     const uint32_t vertex)
+    {
+        Vec3 position;
+        std::memcpy(position.data(),
+                    source.Vertices.data() +
+                        static_cast<size_t>(vertex) * source.VertexStride,
+                    sizeof(position));
+        return position;
+    }
+
+    int8_t QuantizeSnorm(const float value)
+    {
+        return static_cast<int8_t>(
+            std::clamp(std::round(value * 127.f), -127.f, 127.f));
+    }
+
+    // Ritter's sphere, within a few percent of the minimal one
+    Float4 ComputeSphere(const std::vector<Vec3>& points)
+    {
+        const auto farthestFrom = [&points](const Vec3& from)
+        {
+            return *std::ranges::max_element(
+                points,
+                {},
+                [&from](const Vec3& point)
+                {
+                    const auto offset = Sub(point, from);
+                    return Dot(offset, offset);
+                });
+        };
+        const auto a = farthestFrom(points.front());
+        const auto b = farthestFrom(a);
+        Vec3 center{(a[0] + b[0]) * 0.5f,
+                    (a[1] + b[1]) * 0.5f,
+                    (a[2] + b[2]) * 0.5f};
+        float radius = std::sqrt(Dot(Sub(b, a), Sub(b, a))) * 0.5f;
+
+        for (const auto& point : points)
+        {
+            const auto offset = Sub(point, center);
+            const float distance = std::sqrt(Dot(offset, offset));
+            if (distance <= radius) continue;
+            const float newRadius = (radius + distance) * 0.5f;
+            const float shift = (newRadius - radius) / distance;
+            for (int i = 0; i < 3; ++i)
+            {
+                center[i] += offset[i] * shift;
+            }
+            radius = newRadius;
+        }
+        return Float4{center[0], center[1], center[2], radius};
+    }
+
+    // The axis is quantized before the spread is measured, so the cone
+    // stays conservative for the axis the shader actually reads
+    uint32_t ComputeCone(const std::vector<Vec3>& normals)
+    {
+        constexpr uint32_t disabledCone = 127u << 24;
+        Vec3 sum{};
+        for (const auto& normal : normals)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                sum[i] += normal[i];
+            }
+        }
+        if (normals.empty() || Dot(sum, sum) == 0.f) return disabledCone;
+
+        const auto axis = Normalize(sum);
+        const std::array quantized{QuantizeSnorm(axis[0]),
+                                   QuantizeSnorm(axis[1]),
+                                   QuantizeSnorm(axis[2])};
+        const auto decoded = Normalize(Vec3{quantized[0] / 127.f,
+                                            quantized[1] / 127.f,
+                                            quantized[2] / 127.f});
+
+        float minDot = 1.f;
+        for (const auto& normal : normals)
+        {
+            minDot = std::min(minDot, Dot(decoded, normal));
+        }
+        // Wide cones almost never cull, skip the test for them
+        if (minDot <= 0.1f) return disabledCone;
+
+        const float cutoff = std::sqrt(1.f - minDot * minDot);
+        const auto cutoffSnorm = static_cast<int8_t>(
+            std::min(127.f, std::ceil(cutoff * 127.f)));
+        return static_cast<uint8_t>(quantized[0]) |
+               static_cast<uint8_t>(quantized[1]) << 8 |
+               static_cast<uint8_t>(quantized[2]) << 16 |
+               static_cast<uint32_t>(static_cast<uint8_t>(cutoffSnorm)) << 24;
+    }
+} // namespace
+
+MeshletData Swift::BuildMeshlets(const MeshletSource& source,
+                                 const MeshletLimits& limits)
+{
+    const uint32_t maxVertices = std::clamp(limits.MaxVertices, 3u, 256u);
+    const uint32_t maxTriangles = std::clamp(limits.MaxTriangles, 1u, 512u);
+    const uint32_t vertexCount =
+        static_cast<uint32_t>(source.Vertices.size() / source.VertexStride);
+
+    MeshletData data;
+    const size_t triangleCount = source.Indices.size() / 3;
+    data.Meshlets.reserve(triangleCount / maxTriangles + 1);
+    data.Vertices.reserve(source.Indices.size() / 2);
+    data.Triangles.reserve(source.Indices.size() + triangleCount / 2);
+
+    // Local index of each source vertex in the open meshlet, or 0xFFFF
+    std::vector<uint16_t> localIndices(vertexCount, 0xFFFF);
+    std::vector<Vec3> points;
+    std::vector<Vec3> normals;
+    Meshlet current{};
+
+    const auto flush = [&]
+    {
+        if (current.TriangleCount == 0) return;
+        const auto vertices =
+            std::span(data.Vertices).subspan(current.VertexOffset);
+        points.clear();
+        for (const auto vertex : vertices)
+        {
+            points.emplace_back(GetPosition(source, vertex));
+            localIndices[vertex] = 0xFFFF;
+        }
+        current.BoundingSphere = ComputeSphere(points);
+        current.Cone = ComputeCone(normals);
+        data.Meshlets.emplace_back(current);
+
+        data.Triangles.resize((data.Triangles.size() + 3) & ~size_t{3});
+        current = Meshlet{
+            .VertexOffset = static_cast<uint32_t>(data.Vertices.size()),
+            .TriangleOffset = static_cast<uint32_t>(data.Triangles.size()),
+        };
+        normals.clear();
+    };
+
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        const std::array corners{source.Indices[triangle * 3],
+                                 source.Indices[triangle * 3 + 1],
+                                 source.Indices[triangle * 3 + 2]};
+        uint32_t newVertices = 0;
+        for (size_t i = 0; i < corners.size(); ++i)
+        {
+            const bool repeated = std::find(corners.begin(),
+                                            corners.begin() + i,
+                                            corners[i]) != corners.begin() + i;
+            if (localIndices[corners[i]] == 0xFFFF && !repeated)
+            {
+                ++newVertices;
+            }
+        }
+        if (current.VertexCount + newVertices > maxVertices ||
+            current.TriangleCount + 1u > maxTriangles)
+        {
+            flush();
+        }
+
+        for (const auto corner : corners)
+        {
+            if (localIndices[corner] == 0xFFFF)
+            {
+                localIndices[corner] = current.VertexCount++;
+                data.Vertices.emplace_back(corner);
+            }
+            data.Triangles.emplace_back(
+                static_cast<uint8_t>(localIndices[corner]));
+        }
+        ++current.TriangleCount;
+
+        const auto p0 = GetPosition(source, corners[0]);
+        const auto normal = Cross(Sub(GetPosition(source, corners[1]), p0),
+                                  Sub(GetPosition(source, corners[2]), p0));
+        // Degenerate triangles face nowhere and can't widen the cone
+        if (Dot(normal, normal) > 0.f)
+        {
+            normals.emplace_back(Normalize(normal));
+        }
+    }
+    flush();
+    return data;
+}
+
+std::vector<MeshletData>
+Swift::BuildMeshlets(const std::span<const MeshletSource> sources,
+                     const MeshletLimits& limits,
+                     uint32_t threadCount)
+{
+    std::vector<MeshletData> results(sources.size());
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threadCount =
+        std::min(threadCount, static_cast<uint32_t>(sources.size()));
+
+    // Meshes vary a lot in size, so workers take the next mesh as they
+    // finish instead of a fixed share
+    std::atomic<size_t> nextSource = 0;
+    const auto work = [&]
+    {
+        for (size_t i = nextSource++; i < sources.size(); i = nextSource++)
+        {
+            results[i] = BuildMeshlets(sources[i], limits);
+        }
+    };
+    {
+        std::vector<std::jthread> workers;
+        for (uint32_t i = 1; i < threadCount; ++i)
+        {
+            workers.emplace_back(work);
+        }
+        work();
+    }
+    return results;
+}
+
+std::expected<MeshletBuffer,
+              Error>
+Swift::UploadMeshlets(const BufferPoolHandle poolHandle,
+                      const MeshletData& data)
+{
+    const uint64_t meshletSize = data.Meshlets.size() * sizeof(Meshlet);
+    const uint64_t vertexSize = data.Vertices.size() * sizeof(uint32_t);
+    const uint64_t triangleSize = (data.Triangles.size() + 3) & ~3ull;
+    const auto sliceResult =
+        AllocateSlice(poolHandle, meshletSize + vertexSize + triangleSize);
+    if (!sliceResult)
+    {
+        return std::unexpected(sliceResult.error());
+    }
+    const auto& slice = sliceResult.value();
+
+    auto* bytes = static_cast<std::byte*>(slice.Data);
+    std::memcpy(bytes, data.Meshlets.data(), meshletSize);
+    std::memcpy(bytes + meshletSize, data.Vertices.data(), vertexSize);
+    std::memcpy(bytes + meshletSize + vertexSize,
+                data.Triangles.data(),
+                data.Triangles.size());
+
+    return MeshletBuffer{
+        .Slice = slice,
+        .MeshletCount = static_cast<uint32_t>(data.Meshlets.size()),
+        .MeshletAddress = slice.Address,
+        .VertexAddress = slice.Address + meshletSize,
+        .TriangleAddress = slice.Address + meshletSize + vertexSize,
+    };
+}
@@ -1,7 +1,18 @@
 #include "Swift.hpp"
+#include "atomic"
+#include "bit"
+#include "condition_variable"
+#include "deque"
+#include "fstream"
+#include "future"
+#include "mutex"
 #include "numeric"
+#include "thread"
+#include "unordered_map"
+#include "unordered_set"
 #define VOLK_IMPLEMENTATION
 #include "Vulkan/VulkanInit.hpp"
+#include "Vulkan/VulkanReflect.hpp"
 #include "Vulkan/VulkanRender.hpp"
 #include "volk.h"
 #define VMA_IMPLEMENTATION
@@ -14,7 +25,7 @@ namespace
     Context gContext;
     Swapchain gSwapchain;
 
-    std::array<FrameData, 3> gFrameData;
+    std::array<FrameData, Vulkan::Constants::FramesInFlight> gFrameData;
     uint32_t gCurrentFrame = 0;
 
     Queue gGraphicsQueue;
@@ -29,271 +40,1894 @@ namespace
     std::vector<Image> gImages;
     std::vector<Image> gTempImages;
     std::vector<Buffer> gBuffers;
+    std::vector<BufferPool> gBufferPools;
     std::vector<VkSampler> gSamplers;
+    std::unordered_map<SamplerCreateInfo,
+                       SamplerHandle,
+                       SamplerHash>
+        gSamplerCache;
+    // Keyed by SPIR-V so pipelines sharing a stage share its module
+    std::unordered_map<std::string,
+                       VkShaderModule,
+                       ShaderCodeHash,
+                       std::equal_to<>>
+        gShaderModules;
+    // The full description of the state a VkPipeline bakes in. Pipelines
+    // are cached by it rather than by a hash of it, so a collision can never
+    // hand out another shader's pipeline
+    using PipelineKey = std::string;
+    // Shaders are cheap records, identical pipeline state shares a VkPipeline
+    std::unordered_map<PipelineKey,
+                       VkPipeline>
+        gGraphicsPipelines;
+
+    // A fast linked pipeline waiting on its optimized link
+    struct OptimizedPipeline
+    {
+        PipelineKey Key;
+        VkPipeline FastLinked;
+        std::future<std::expected<VkPipeline,
+                                  Error>>
+            Optimized;
+    };
+    // Keyed on the part's own description, parts are shared across pipelines
+    std::unordered_map<PipelineKey,
+                       VkPipeline>
+        gPipelineLibraries;
+    std::vector<OptimizedPipeline> gOptimizedPipelines;
+    // Optimized links run on a few workers, so a burst of new shaders queues
+    // its links instead of starting a thread each
+    struct LinkWorkers
+    {
+        std::mutex Mutex;
+        std::condition_variable_any Queued;
+        std::deque<std::packaged_task<std::expected<VkPipeline,
+                                                    Error>()>>
+            Tasks;
+        std::vector<std::jthread> Threads;
+    };
+    LinkWorkers gLinkWorkers;
+
+    // Kept per handle so a reload can rebuild the shader around new code
+    using ShaderCreateInfo = std::variant<GraphicsShaderCreateInfo,
+                                          ComputeShaderCreateInfo>;
+    std::vector<ShaderCreateInfo> gShaderCreateInfos;
+
+    // Reloaded pipelines belong to their shader alone, they are keyed by
+    // modules that only live as long as the reload
+    struct ReloadedShader
+    {
+        VkPipeline Pipeline = nullptr;
+        std::vector<VkShaderEXT> ShaderObjects;
+    };
+    struct PendingReload
+    {
+        ShaderHandle Handle;
+        std::shared_ptr<const ShaderCreateInfo> CreateInfo;
+        ShaderReflection Reflection;
+        // Made outside gShaderModules, so edited code doesn't pile up modules
+        // that are only freed at Shutdown
+        std::vector<VkShaderModule> Modules;
+        std::future<std::expected<ReloadedShader,
+                                  Error>>
+            Result;
+        // A later reload of the same shader replaces this one
+        bool Superseded = false;
+    };
+    std::vector<PendingReload> gPendingReloads;
+
+    struct WatchedShaderFile
+    {
+        ShaderHandle Handle;
+        ShaderStage Stage;
+        std::filesystem::path Path;
+        std::filesystem::file_time_type WriteTime;
+    };
+    std::vector<WatchedShaderFile> gWatchedShaderFiles;
+    std::chrono::steady_clock::time_point gLastShaderFilePoll;
+
+    VkPipelineCache gPipelineCache;
+    std::vector<PipelineRecord> gPipelineRecords;
+    uint64_t gFrameNumber = 0;
+
+    std::vector<Query> gQueries;
+    // Slots handed out per pool, occlusion then pipeline statistics
+    std::array<uint32_t, 2> gQuerySlots{};
+    constexpr VkQueryPipelineStatisticFlags gQueryStatistics =
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+    constexpr std::array gPipelineParts{
+        VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+    };
     std::vector<VkViewport> gViewports;
     std::vector<VkRect2D> gScissors;
-} // namespace
+    bool gRendering = false;
+    // A rejected BeginConditionalRendering began nothing for End to end
+    bool gConditionalRendering = false;
 
-std::expected<void,
-              Error>
-Swift::Init(const InitInfo& info)
-{
-    const auto contextResult = Vulkan::CreateContext(info);
-    if (!contextResult)
+    // Dynamic buffers resolve to the copy owned by the current frame
+    uint64_t GetBufferOffset(const Buffer& buffer)
     {
-        return std::unexpected(contextResult.error());
+        return buffer.Dynamic ? buffer.VersionStride * gCurrentFrame : 0;
     }
-    gContext = contextResult.value();
 
-    const auto queueResult =
-        Vulkan::CreateQueue(gContext, vkb::QueueType::graphics);
-    if (!queueResult)
+    // Accesses that needed a barrier inside rendering, recorded before the
+    // next BeginRendering so only the pass that first hit them fails
+    std::vector<BufferTransition> gDeferredTransitions;
+
+    // Hazard state is kept for the whole buffer, so the barrier covers the
+    // whole buffer, or the current frame's copy of a dynamic one, whatever
+    // range the command touches. Inside rendering the barrier cannot be
+    // recorded, the access is deferred and FlushBufferBarriers fails
+    void TrackBufferAccess(std::vector<VkBufferMemoryBarrier2>& barriers,
+                           const BufferHandle bufferHandle,
+                           const VkPipelineStageFlags2 stage,
+                           const VkAccessFlags2 access)
     {
-        return std::unexpected(queueResult.error());
+        auto& buffer = gBuffers.at(bufferHandle);
+        const auto barrier =
+            Vulkan::GetBufferBarrier(buffer,
+                                     stage,
+                                     access,
+                                     GetBufferOffset(buffer),
+                                     buffer.Dynamic ? buffer.VersionStride
+                                                    : VK_WHOLE_SIZE);
+        if (barrier)
+        {
+            barriers.emplace_back(barrier.value());
+            if (gRendering)
+            {
+                const BufferTransition transition{
+                    .Buffer = bufferHandle,
+                    .Stage = stage,
+                    .Access = access,
+                };
+                const bool deferred = std::ranges::any_of(
+                    gDeferredTransitions,
+                    [&transition](const BufferTransition& pending)
+                    {
+                        return pending.Buffer == transition.Buffer &&
+                               pending.Stage == transition.Stage &&
+                               pending.Access == transition.Access;
+                    });
+                if (!deferred) gDeferredTransitions.emplace_back(transition);
+                return;
+            }
+        }
+        Vulkan::RecordBufferAccess(buffer, stage, access);
     }
-    gGraphicsQueue = queueResult.value();
 
-    const auto transferQueueResult =
-        Vulkan::CreateQueue(gContext, vkb::QueueType::transfer);
-    if (!transferQueueResult)
+    // Returns false when the barriers cannot be recorded, the command that
+    // needed them must then fail with eBarrierInsideRendering
+    bool FlushBufferBarriers(const std::vector<VkBufferMemoryBarrier2>& barriers)
     {
-        return std::unexpected(queueResult.error());
+        if (barriers.empty())
+        {
+            return true;
+        }
+        if (gRendering)
+        {
+#ifdef SWIFT_DEBUG
+            std::cerr << "Swift: a buffer needs a barrier inside rendering, "
+                         "the command failed and the barrier is recorded at "
+                         "the next BeginRendering. Transition it with "
+                         "TransitionBuffers before BeginRendering\n";
+#endif
+            return false;
+        }
+        Vulkan::PipelineBarrier(gFrameData.at(gCurrentFrame).Command.Buffer,
+                                {},
+                                barriers);
+        return true;
     }
-    gTransferQueue = transferQueueResult.value();
 
-    const auto transferFenceResult = Vulkan::CreateFence(gContext.Device);
-    if (!transferFenceResult)
+    // Called outside rendering, the state is read again so the barriers
+    // match whatever ran since the accesses were deferred
+    void FlushDeferredTransitions()
     {
-        return std::unexpected(transferFenceResult.error());
+        std::vector<VkBufferMemoryBarrier2> barriers;
+        for (const auto& transition : gDeferredTransitions)
+        {
+            if (!gBuffers.at(transition.Buffer).Allocation) continue;
+            TrackBufferAccess(barriers,
+                              transition.Buffer,
+                              transition.Stage,
+                              transition.Access);
+        }
+        gDeferredTransitions.clear();
+        FlushBufferBarriers(barriers);
     }
-    gTransferFence = transferFenceResult.value();
 
-    const auto transferCommandResult =
-        Vulkan::CreateCommand(gContext.Device, gTransferQueue.QueueIndex);
-    if (!transferCommandResult)
+    std::expected<BufferPoolBlock,
+                  Error>
+    CreatePoolBlock(const BufferPool& pool,
+                    const uint64_t size)
     {
-        return std::unexpected(transferCommandResult.error());
+        const BufferCreateInfo bufferCreateInfo{
+            .Usage = pool.Usage,
+            .Size = size,
+        };
+        const auto bufferResult = Swift::CreateBuffer(bufferCreateInfo);
+        if (!bufferResult)
+        {
+            return std::unexpected(bufferResult.error());
+        }
+        const auto blockResult = Vulkan::CreateVirtualBlock(size);
+        if (!blockResult)
+        {
+            Swift::DestroyBuffer(bufferResult.value());
+            return std::unexpected(blockResult.error());
+        }
+        return BufferPoolBlock{bufferResult.value(), blockResult.value()};
     }
-    gTransferCommand = transferCommandResult.value();
 
-    const auto swapchainResult =
-        Vulkan::CreateSwapchain(gContext, gGraphicsQueue, info.Extent);
-    if (!swapchainResult)
+    std::expected<VkShaderModule,
+                  Error>
+    GetShaderModule(const std::vector<char>& code)
     {
-        return std::unexpected(swapchainResult.error());
+        const std::string_view key(code.data(), code.size());
+        if (const auto it = gShaderModules.find(key);
+            it != gShaderModules.end())
+        {
+            return it->second;
+        }
+        const auto moduleResult =
+            Vulkan::CreateShaderModule(gContext.Device, code);
+        if (!moduleResult)
+        {
+            return std::unexpected(moduleResult.error());
+        }
+        gShaderModules.emplace(key, moduleResult.value());
+        return moduleResult.value();
     }
-    gSwapchain = swapchainResult.value();
 
-    for (auto& frameData : gFrameData)
+    // Every pipeline shares one push constant range, a larger block would
+    // fail on every push instead of once here
+    bool IsPushConstantSizeValid(const ShaderReflection& reflection)
     {
-        const auto frameDataResult = Vulkan::CreateFrameData(gContext.Device);
-        if (!frameDataResult)
+        if (reflection.PushConstantSize <= Vulkan::Constants::PushConstantSize)
         {
-            return std::unexpected(frameDataResult.error());
+            return true;
         }
-        frameData = frameDataResult.value();
+#ifdef SWIFT_DEBUG
+        std::cerr << "Swift: push constant block of "
+                  << reflection.PushConstantSize << " bytes exceeds "
+                  << Vulkan::Constants::PushConstantSize << "\n";
+#endif
+        return false;
     }
 
-    const auto descriptorResult = Vulkan::CreateDescriptor(gContext.Device);
-    if (!descriptorResult)
+    void RecordPipeline(const uint64_t hash,
+                        const VkPipelineCreationFeedback& feedback,
+                        const std::chrono::nanoseconds cpuTime,
+                        const bool replayed)
     {
-        return std::unexpected(descriptorResult.error());
+        const bool valid =
+            feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT;
+        gPipelineRecords.emplace_back(PipelineRecord{
+            .Hash = hash,
+            .DurationNs = valid ? feedback.duration
+                                : static_cast<uint64_t>(cpuTime.count()),
+            .Frame = gFrameNumber,
+            .CacheHit =
+                valid &&
+                (feedback.flags &
+                 VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) !=
+                    0,
+            .Replayed = replayed,
+        });
     }
-    gDescriptor = descriptorResult.value();
 
-    const auto pipelineLayoutResult =
-        Vulkan::CreatePipelineLayout(gContext, gDescriptor.Layout);
-    if (!pipelineLayoutResult)
+    using StageCode = std::tuple<const std::vector<char>*,
+                                 ShaderStage,
+                                 const ShaderSpecialization*>;
+
+    std::vector<StageCode> GetStageCode(
+        const ComputeShaderCreateInfo& createInfo)
     {
-        return std::unexpected(pipelineLayoutResult.error());
+        return {{&createInfo.ComputeCode,
+                 ShaderStage::eCompute,
+                 &createInfo.Specialization}};
     }
-    gPipelineLayout = pipelineLayoutResult.value();
 
-    constexpr SamplerCreateInfo samplerCreateInfo{};
-    const auto samplerResult =
-        Vulkan::CreateSampler(gContext, samplerCreateInfo);
-    if (!samplerResult)
+    std::vector<StageCode> GetStageCode(
+        const GraphicsShaderCreateInfo& graphics)
     {
-        return std::unexpected(samplerResult.error());
+        std::vector<StageCode> stageCode;
+        if (!graphics.MeshCode.empty())
+        {
+            if (!graphics.TaskCode.empty())
+            {
+                stageCode.emplace_back(&graphics.TaskCode,
+                                       ShaderStage::eTask,
+                                       &graphics.TaskSpecialization);
+            }
+            stageCode.emplace_back(&graphics.MeshCode,
+                                   ShaderStage::eMesh,
+                                   &graphics.MeshSpecialization);
+        }
+        else
+        {
+            stageCode.emplace_back(&graphics.VertexCode,
+                                   ShaderStage::eVertex,
+                                   &graphics.VertexSpecialization);
+            if (!graphics.GeometryCode.empty())
+            {
+                stageCode.emplace_back(&graphics.GeometryCode,
+                                       ShaderStage::eGeometry,
+                                       &graphics.GeometrySpecialization);
+            }
+        }
+        stageCode.emplace_back(&graphics.FragmentCode,
+                               ShaderStage::eFragment,
+                               &graphics.FragmentSpecialization);
+        return stageCode;
     }
-    gSamplers.emplace_back(samplerResult.value());
-
-    return {};
-}
-
-void Swift::Shutdown()
-{
-    vkDeviceWaitIdle(gContext.Device);
 
-    for (const auto& sampler : gSamplers)
+    std::vector<StageCode> GetStageCode(const ShaderCreateInfo& createInfo)
     {
-        vkDestroySampler(gContext.Device, sampler, nullptr);
+        return std::visit(
+            [](const auto& info)
+            {
+                return GetStageCode(info);
+            },
+            createInfo);
     }
 
-    for (const auto& image : gImages)
+    std::vector<char>* GetStageCodeField(ShaderCreateInfo& createInfo,
+                                         const ShaderStage stage)
     {
-        if (!image.Allocation) continue;
-        vmaDestroyImage(gContext.Allocator, image.BaseImage, image.Allocation);
-        vkDestroyImageView(gContext.Device, image.ImageView, nullptr);
+        if (auto* compute = std::get_if<ComputeShaderCreateInfo>(&createInfo))
+        {
+            return stage == ShaderStage::eCompute ? &compute->ComputeCode
+                                                  : nullptr;
+        }
+        auto& graphics = std::get<GraphicsShaderCreateInfo>(createInfo);
+        switch (stage)
+        {
+        case ShaderStage::eVertex:
+            return &graphics.VertexCode;
+        case ShaderStage::eGeometry:
+            return &graphics.GeometryCode;
+        case ShaderStage::eFragment:
+            return &graphics.FragmentCode;
+        case ShaderStage::eTask:
+            return &graphics.TaskCode;
+        case ShaderStage::eMesh:
+            return &graphics.MeshCode;
+        default:
+            return nullptr;
+        }
     }
 
-    for (auto& tempImage : gTempImages)
+    std::expected<ShaderReflection,
+                  Error>
+    ReflectStages(const std::vector<StageCode>& stageCode)
     {
-        if (!tempImage.BaseImage) continue;
-        Vulkan::DestroyImage(gContext, tempImage);
+        ShaderReflection reflection;
+        for (const auto& [code, stage, specialization] : stageCode)
+        {
+            const auto reflectResult =
+                Vulkan::ReflectShader(*code, *specialization, reflection);
+            if (!reflectResult)
+            {
+                return std::unexpected(reflectResult.error());
+            }
+        }
+        if (!IsPushConstantSizeValid(reflection))
+        {
+            return std::unexpected(Error::eShaderCreateFailed);
+        }
+        return reflection;
     }
 
-    for (auto& buffer : gBuffers)
+    std::expected<std::vector<VkShaderModule>,
+                  Error>
+    GetShaderModules(const std::vector<StageCode>& stageCode)
     {
-        if (!buffer.Allocation) continue;
-        Vulkan::DestroyBuffer(gContext.Allocator, buffer);
+        std::vector<VkShaderModule> modules;
+        for (const auto& [code, stage, specialization] : stageCode)
+        {
+            const auto moduleResult = GetShaderModule(*code);
+            if (!moduleResult)
+            {
+                return std::unexpected(moduleResult.error());
+            }
+            modules.emplace_back(moduleResult.value());
+        }
+        return modules;
     }
 
-    for (const auto& shader : gShaders)
+    // The stages point into specializationInfos, which must outlive them
+    std::vector<VkPipelineShaderStageCreateInfo>
+    GetShaderStages(const std::vector<StageCode>& stageCode,
+                    const std::vector<VkShaderModule>& modules,
+                    std::vector<VkSpecializationInfo>& specializationInfos)
     {
-        vkDestroyPipeline(gContext.Device, shader.Pipeline, nullptr);
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+        specializationInfos.clear();
+        specializationInfos.reserve(stageCode.size());
+        for (size_t i = 0; i < stageCode.size(); ++i)
+        {
+            const auto& [code, stage, specialization] = stageCode[i];
+            const auto& specializationInfo = specializationInfos.emplace_back(
+                Vulkan::GetSpecializationInfo(specialization->Constants));
+            shaderStages.emplace_back(
+                Vulkan::GetShaderStage(modules[i],
+                                       stage,
+                                       specialization->EntryPoint.c_str(),
+                                       &specializationInfo));
+        }
+        return shaderStages;
     }
-    vkDestroyPipelineLayout(gContext.Device, gPipelineLayout, nullptr);
 
-    for (const auto& [Command, ImageAvailable, RenderFinished, Fence] :
-         gFrameData)
+    template <typename T>
+    void AppendKey(PipelineKey& key,
+                   const T value)
     {
-        vkDestroyCommandPool(gContext.Device, Command.Pool, nullptr);
-        vkDestroySemaphore(gContext.Device, ImageAvailable, nullptr);
-        vkDestroySemaphore(gContext.Device, RenderFinished, nullptr);
-        vkDestroyFence(gContext.Device, Fence, nullptr);
+        static_assert(std::is_scalar_v<T>);
+        key.append(reinterpret_cast<const char*>(&value), sizeof(T));
     }
 
-    vkDestroyFence(gContext.Device, gTransferFence, nullptr);
-    vkDestroyCommandPool(gContext.Device, gTransferCommand.Pool, nullptr);
-    vkDestroyDescriptorPool(gContext.Device, gDescriptor.Pool, nullptr);
-    vkDestroyDescriptorSetLayout(gContext.Device, gDescriptor.Layout, nullptr);
+    // Length prefixed, so the bytes can't run into the next field
+    void AppendKeyBytes(PipelineKey& key,
+                        const std::string_view bytes)
+    {
+        AppendKey(key, bytes.size());
+        key.append(bytes);
+    }
 
-    for (const auto& image : gSwapchain.Images)
+    void AppendStencilKey(PipelineKey& key,
+                          const VkStencilOpState& stencil)
     {
-        vkDestroyImageView(gContext.Device, image.ImageView, nullptr);
+        AppendKey(key, stencil.failOp);
+        AppendKey(key, stencil.passOp);
+        AppendKey(key, stencil.depthFailOp);
+        AppendKey(key, stencil.compareOp);
+        AppendKey(key, stencil.compareMask);
+        AppendKey(key, stencil.writeMask);
+        AppendKey(key, stencil.reference);
     }
-    Vulkan::DestroyImage(gContext, gSwapchain.DepthImage);
-    vkDestroySwapchainKHR(gContext.Device, gSwapchain.SwapChain, nullptr);
-    vmaDestroyAllocator(gContext.Allocator);
-    vkb::destroy_device(gContext.Device);
-    vkDestroySurfaceKHR(gContext.Instance, gContext.Surface, nullptr);
-    vkb::destroy_instance(gContext.Instance);
-}
 
-std::expected<void,
-              Error>
-Swift::BeginFrame(const DynamicInfo& info)
-{
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    auto result = Vulkan::WaitFence(gContext.Device, currentFrameData.Fence);
-    if (!result)
+    // Modules are unique per SPIR-V, so stages are keyed by module handle
+    void AppendStageKey(PipelineKey& key,
+                        const VkPipelineShaderStageCreateInfo& stage)
     {
-        return std::unexpected(result.error());
+        AppendKey(key, stage.module);
+        AppendKey(key, stage.stage);
+        AppendKeyBytes(key, stage.pName);
+        const auto& specialization = *stage.pSpecializationInfo;
+        AppendKey(key, specialization.mapEntryCount);
+        for (uint32_t i = 0; i < specialization.mapEntryCount; ++i)
+        {
+            const auto& entry = specialization.pMapEntries[i];
+            AppendKey(key, entry.constantID);
+            AppendKey(key, entry.offset);
+            AppendKey(key, entry.size);
+        }
+        AppendKeyBytes(key,
+                       std::string_view(
+                           static_cast<const char*>(specialization.pData),
+                           specialization.dataSize));
     }
 
-    if (info.Extent != gSwapchain.Dimensions)
+    // The state one pipeline library part bakes in, state left dynamic by
+    // extended dynamic state 3 is skipped
+    PipelineKey GetPipelinePartKey(
+        const GraphicsShaderCreateInfo& createInfo,
+        const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages,
+        const VkGraphicsPipelineLibraryFlagsEXT part)
     {
-        const auto swapchainResult = Vulkan::RecreateSwapchain(gContext,
-            gGraphicsQueue,
-            gSwapchain,
-            info.Extent);
-        if (!swapchainResult)
+        const bool dynamicState3 = gContext.Features.ExtendedDynamicState3;
+        const auto appendStages = [&](PipelineKey& key,
+                                      const bool fragment)
         {
-            return std::unexpected(swapchainResult.error());
+            auto partStages =
+                shaderStages |
+                std::views::filter(
+                    [fragment](const VkPipelineShaderStageCreateInfo& stage)
+                    {
+                        return (stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT) ==
+                               fragment;
+                    });
+            AppendKey(key, std::ranges::distance(partStages));
+            for (const auto& stage : partStages)
+            {
+                AppendStageKey(key, stage);
+            }
+        };
+
+        PipelineKey key;
+        AppendKey(key, part);
+        switch (part)
+        {
+        case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+            AppendKey(key, createInfo.Topology);
+            break;
+        case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+        {
+            appendStages(key, false);
+            const auto& raster = createInfo.Raster;
+            if (!dynamicState3)
+            {
+                AppendKey(key, createInfo.PolygonMode);
+                AppendKey(key, raster.DepthClampEnable);
+            }
+            AppendKey(key, raster.DepthBiasEnable);
+            AppendKey(key, raster.DepthBiasConstantFactor);
+            AppendKey(key, raster.DepthBiasClamp);
+            AppendKey(key, raster.DepthBiasSlopeFactor);
+            break;
+        }
+        case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+        {
+            appendStages(key, true);
+            const auto& depthStencil = createInfo.DepthStencil;
+            AppendKey(key, depthStencil.StencilTest);
+            AppendStencilKey(key, depthStencil.StencilFront);
+            AppendStencilKey(key, depthStencil.StencilBack);
+            AppendKey(key, createInfo.DepthFormat);
+            if (!dynamicState3) AppendKey(key, createInfo.Samples);
+            break;
+        }
+        case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+            AppendKey(key, createInfo.ColorFormats.size());
+            for (size_t i = 0; i < createInfo.ColorFormats.size(); ++i)
+            {
+                AppendKey(key, createInfo.ColorFormats[i]);
+                if (dynamicState3) continue;
+                const auto blend = i < createInfo.BlendStates.size()
+                                       ? createInfo.BlendStates[i]
+                                       : BlendState{};
+                AppendKey(key, blend.BlendEnable);
+                AppendKey(key, blend.SrcColorFactor);
+                AppendKey(key, blend.DstColorFactor);
+                AppendKey(key, blend.ColorOp);
+                AppendKey(key, blend.SrcAlphaFactor);
+                AppendKey(key, blend.DstAlphaFactor);
+                AppendKey(key, blend.AlphaOp);
+                AppendKey(key, blend.WriteMask);
+            }
+            AppendKey(key, createInfo.DepthFormat);
+            if (!dynamicState3) AppendKey(key, createInfo.Samples);
+            break;
+        default:
+            break;
         }
+        return key;
     }
 
-    const auto acquireResult =
-        Vulkan::AcquireNextImage(gContext,
-                                 gSwapchain,
-                                 currentFrameData.ImageAvailable);
+    // Only state baked into the VkPipeline is part of the key
+    PipelineKey GetGraphicsPipelineKey(
+        const GraphicsShaderCreateInfo& createInfo,
+        const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages)
+    {
+        PipelineKey key;
+        for (const auto part : gPipelineParts)
+        {
+            AppendKeyBytes(key,
+                           GetPipelinePartKey(createInfo, shaderStages, part));
+        }
+        return key;
+    }
 
-    result = Vulkan::ResetFence(gContext.Device, currentFrameData.Fence);
-    if (!result)
+    // What pipeline records identify a pipeline by
+    uint64_t GetPipelineHash(const PipelineKey& key)
     {
-        return std::unexpected(result.error());
+        return std::hash<PipelineKey>{}(key);
     }
 
-    if (!acquireResult)
+    std::expected<VkPipeline,
+                  Error>
+    GetPipelineLibrary(
+        const GraphicsShaderCreateInfo& createInfo,
+        const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages,
+        const VkGraphicsPipelineLibraryFlagsEXT part)
     {
-        const auto swapchainResult = Vulkan::RecreateSwapchain(gContext,
-            gGraphicsQueue,
-            gSwapchain,
-            info.Extent);
-        if (!swapchainResult)
+        auto partKey = GetPipelinePartKey(createInfo, shaderStages, part);
+        if (const auto it = gPipelineLibraries.find(partKey);
+            it != gPipelineLibraries.end())
         {
-            return std::unexpected(swapchainResult.error());
+            return it->second;
+        }
+
+        std::vector<VkPipelineShaderStageCreateInfo> partStages;
+        for (const auto& stage : shaderStages)
+        {
+            const bool fragment = stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT;
+            if ((part ==
+                     VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT &&
+                 !fragment) ||
+                (part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT &&
+                 fragment))
+            {
+                partStages.emplace_back(stage);
+            }
+        }
+        const auto libraryResult =
+            Vulkan::CreateGraphicsPipeline(gContext.Device,
+                                           gPipelineCache,
+                                           gPipelineLayout,
+                                           partStages,
+                                           createInfo,
+                                           gContext.Features,
+                                           part);
+        if (!libraryResult)
+        {
+            return std::unexpected(libraryResult.error());
         }
+        gPipelineLibraries.emplace(std::move(partKey), libraryResult.value());
+        return libraryResult.value();
     }
-    gSwapchain.CurrentImageIndex = acquireResult.value();
 
-    Vulkan::BeginCommandBuffer(currentFrameData.Command);
+    std::future<std::expected<VkPipeline,
+                              Error>>
+    QueueOptimizedLink(std::vector<VkPipeline> libraries)
+    {
+        std::packaged_task<std::expected<VkPipeline,
+                                         Error>()>
+            task(
+                [libraries = std::move(libraries)]
+                {
+                    return Vulkan::LinkGraphicsPipeline(gContext.Device,
+                                                        gPipelineCache,
+                                                        gPipelineLayout,
+                                                        libraries,
+                                                        true);
+                });
+        auto future = task.get_future();
+        {
+            std::scoped_lock lock(gLinkWorkers.Mutex);
+            gLinkWorkers.Tasks.emplace_back(std::move(task));
+        }
+        gLinkWorkers.Queued.notify_one();
 
-    return {};
-}
+        if (gLinkWorkers.Threads.empty())
+        {
+            const uint32_t threadCount =
+                std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+            for (uint32_t i = 0; i < threadCount; ++i)
+            {
+                gLinkWorkers.Threads.emplace_back(
+                    [](const std::stop_token stopToken)
+                    {
+                        while (true)
+                        {
+                            std::unique_lock lock(gLinkWorkers.Mutex);
+                            if (!gLinkWorkers.Queued.wait(
+                                    lock,
+                                    stopToken,
+                                    []
+                                    {
+                                        return !gLinkWorkers.Tasks.empty();
+                                    }))
+                            {
+                                return;
+                            }
+                            auto task = std::move(gLinkWorkers.Tasks.front());
+                            gLinkWorkers.Tasks.pop_front();
+                            lock.unlock();
+                            task();
+                        }
+                    });
+            }
+        }
+        return future;
+    }
 
-std::expected<void,
-              Error>
-Swift::EndFrame(const DynamicInfo& info)
-{
-    const auto& [Command, ImageAvailable, RenderFinished, Fence] =
-        gFrameData.at(gCurrentFrame);
+    // Fast links the cached parts, which takes a fraction of a full compile,
+    // and queues the optimized link on the link workers
+    std::expected<VkPipeline,
+                  Error>
+    CreateLinkedPipeline(
+        const GraphicsShaderCreateInfo& createInfo,
+        const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages,
+        const PipelineKey& pipelineKey)
+    {
+        const bool meshPipeline =
+            std::ranges::any_of(shaderStages,
+                                [](const VkPipelineShaderStageCreateInfo& stage)
+                                {
+                                    return stage.stage ==
+                                           VK_SHADER_STAGE_MESH_BIT_EXT;
+                                });
+        std::vector<VkPipeline> libraries;
+        for (const auto part : gPipelineParts)
+        {
+            // Mesh pipelines have no vertex input interface
+            if (meshPipeline &&
+                part ==
+                    VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT)
+            {
+                continue;
+            }
+            const auto libraryResult =
+                GetPipelineLibrary(createInfo, shaderStages, part);
+            if (!libraryResult)
+            {
+                return std::unexpected(libraryResult.error());
+            }
+            libraries.emplace_back(libraryResult.value());
+        }
 
-    auto& image = Vulkan::GetSwapchainImage(gSwapchain);
+        VkPipelineCreationFeedback feedback{};
+        const auto start = std::chrono::steady_clock::now();
+        const auto pipelineResult =
+            Vulkan::LinkGraphicsPipeline(gContext.Device,
+                                         gPipelineCache,
+                                         gPipelineLayout,
+                                         libraries,
+                                         false,
+                                         &feedback);
+        if (!pipelineResult)
+        {
+            return std::unexpected(pipelineResult.error());
+        }
+        RecordPipeline(GetPipelineHash(pipelineKey),
+                       feedback,
+                       std::chrono::steady_clock::now() - start,
+                       false);
+        gOptimizedPipelines.emplace_back(OptimizedPipeline{
+            .Key = pipelineKey,
+            .FastLinked = pipelineResult.value(),
+            .Optimized = QueueOptimizedLink(std::move(libraries)),
+        });
+        return pipelineResult.value();
+    }
 
-    const auto presentTransition =
-        Vulkan::TransitionImage(image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
-    Vulkan::PipelineBarrier(Command.Buffer, {presentTransition});
-    Vulkan::EndCommandBuffer(Command);
+    // Shaders move to finished optimized links, the fast links they replace
+    // are destroyed once this frame slot's fence is waited on again
+    void SwapOptimizedPipelines(FrameData& frameData)
+    {
+        std::erase_if(
+            gOptimizedPipelines,
+            [&frameData](OptimizedPipeline& pending)
+            {
+                if (pending.Optimized.wait_for(std::chrono::seconds(0)) !=
+                    std::future_status::ready)
+                {
+                    return false;
+                }
+                const auto optimizedResult = pending.Optimized.get();
+                if (!optimizedResult)
+                {
+                    return true;
+                }
+                gGraphicsPipelines[pending.Key] = optimizedResult.value();
+                for (auto& shader : gShaders)
+                {
+                    if (shader.Pipeline == pending.FastLinked)
+                    {
+                        shader.Pipeline = optimizedResult.value();
+                    }
+                }
+                frameData.RetiredPipelines.emplace_back(pending.FastLinked);
+                return true;
+            });
+    }
 
-    const SubmitInfo submitInfo{
-        .WaitSemaphore = ImageAvailable,
-        .WaitPipelineStage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .SignalSemaphore = RenderFinished,
-        .SignalPipelineStage = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
-        .Fence = Fence,
-    };
-    Vulkan::SubmitQueue(gGraphicsQueue, Command, submitInfo);
+    // Shader objects take the extended dynamic state 3 commands without the
+    // extension
+    bool HasDynamicState3()
+    {
+        return gContext.Features.ExtendedDynamicState3 ||
+               gContext.Features.ShaderObject;
+    }
 
-    if (!Vulkan::Present(gSwapchain, gGraphicsQueue, RenderFinished))
+    void BindShaderObjects(const Shader& shader)
     {
-        const auto swapchainResult = Vulkan::RecreateSwapchain(gContext,
-            gGraphicsQueue,
-            gSwapchain,
-            info.Extent);
-        if (!swapchainResult)
+        // Every stage is bound, so stages the shader lacks are unbound
+        constexpr std::array graphicsStages{
+            VK_SHADER_STAGE_VERTEX_BIT,
+            VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+            VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+            VK_SHADER_STAGE_GEOMETRY_BIT,
+            VK_SHADER_STAGE_FRAGMENT_BIT,
+            VK_SHADER_STAGE_TASK_BIT_EXT,
+            VK_SHADER_STAGE_MESH_BIT_EXT,
+        };
+        std::array<VkShaderEXT, graphicsStages.size()> shaderObjects{};
+        for (size_t i = 0; i < shader.ShaderObjects.size(); ++i)
         {
-            return std::unexpected(swapchainResult.error());
+            const auto slot =
+                std::ranges::find(graphicsStages, shader.ShaderObjectStages[i]);
+            shaderObjects[slot - graphicsStages.begin()] =
+                shader.ShaderObjects[i];
         }
+        const uint32_t stageCount = gContext.Features.MeshShader ? 7 : 5;
+        vkCmdBindShadersEXT(gFrameData.at(gCurrentFrame).Command.Buffer,
+                            stageCount,
+                            graphicsStages.data(),
+                            shaderObjects.data());
     }
 
-    gCurrentFrame = (gCurrentFrame + 1) % gFrameData.size();
-    return {};
-}
+    void SetStencilState(const VkCommandBuffer commandBuffer,
+                         const VkStencilFaceFlags face,
+                         const VkStencilOpState& stencil)
+    {
+        vkCmdSetStencilOp(commandBuffer,
+                          face,
+                          stencil.failOp,
+                          stencil.passOp,
+                          stencil.depthFailOp,
+                          stencil.compareOp);
+        vkCmdSetStencilCompareMask(commandBuffer, face, stencil.compareMask);
+        vkCmdSetStencilWriteMask(commandBuffer, face, stencil.writeMask);
+        vkCmdSetStencilReference(commandBuffer, face, stencil.reference);
+    }
 
-void Swift::BeginRendering()
-{
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    auto& swapchainImage = Vulkan::GetSwapchainImage(gSwapchain);
-    const auto renderTransition =
-        Vulkan::TransitionImage(swapchainImage,
-                                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-    const auto depthTransition =
-        Vulkan::TransitionImage(swapchainImage,
-                                VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
-    Vulkan::PipelineBarrier(currentFrameData.Command.Buffer,
-                            {renderTransition, depthTransition});
+    // Shader objects bake in no state, so what pipelines keep static has to
+    // be set before drawing as well
+    void SetShaderObjectState(const Shader& shader)
+    {
+        auto& currentFrameData = gFrameData.at(gCurrentFrame);
+        auto& state = currentFrameData.State;
+        const auto commandBuffer = currentFrameData.Command.Buffer;
+        if (!state.ShaderObjectDefaults)
+        {
+            vkCmdSetRasterizerDiscardEnable(commandBuffer, false);
+            vkCmdSetPrimitiveRestartEnable(commandBuffer, false);
+            vkCmdSetDepthBoundsTestEnable(commandBuffer, false);
+            vkCmdSetAlphaToCoverageEnableEXT(commandBuffer, false);
+            // Vertices are pulled from buffers, there is no vertex input
+            vkCmdSetVertexInputEXT(commandBuffer, 0, nullptr, 0, nullptr);
+            state.ShaderObjectDefaults = true;
+        }
 
-    const VkRenderingAttachmentInfo colorInfo{
-        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-        .imageView = swapchainImage.ImageView,
-        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
-        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-    };
+        // What pipelines used to default to, for state never set this frame
+        if (!state.CullMode) SetCullMode(CullMode::eBack);
+        if (!state.FrontFace) SetFrontFace(FrontFace::eCounterClockWise);
+        if (!state.DepthTest) SetDepthTest(true);
+        if (!state.DepthWrite) SetDepthWrite(true);
+        if (!state.DepthCompareOp)
+        {
+            SetDepthCompareOp(DepthCompareOp::eLessOrEqual);
+        }
+        if (!state.LineWidth) SetLineWidth(1.f);
+        if (!state.Topology) SetTopology(shader.Topology);
 
-    const VkRenderingAttachmentInfo depthInfo{
+        constexpr std::array<VkSampleMask, 2> sampleMask{~0u, ~0u};
+        vkCmdSetSampleMaskEXT(commandBuffer, shader.Samples, sampleMask.data());
+
+        const auto& raster = shader.Raster;
+        vkCmdSetDepthBiasEnable(commandBuffer, raster.DepthBiasEnable);
+        if (raster.DepthBiasEnable)
+        {
+            vkCmdSetDepthBias(commandBuffer,
+                              raster.DepthBiasConstantFactor,
+                              raster.DepthBiasClamp,
+                              raster.DepthBiasSlopeFactor);
+        }
+        const auto& depthStencil = shader.DepthStencil;
+        vkCmdSetStencilTestEnable(commandBuffer, depthStencil.StencilTest);
+        if (depthStencil.StencilTest)
+        {
+            SetStencilState(commandBuffer,
+                            VK_STENCIL_FACE_FRONT_BIT,
+                            depthStencil.StencilFront);
+            SetStencilState(commandBuffer,
+                            VK_STENCIL_FACE_BACK_BIT,
+                            depthStencil.StencilBack);
+        }
+    }
+    void DestroyShaderModules(const std::vector<VkShaderModule>& modules)
+    {
+        for (const auto shaderModule : modules)
+        {
+            vkDestroyShaderModule(gContext.Device, shaderModule, nullptr);
+        }
+    }
+
+    void DestroyReloadedShader(const ReloadedShader& reloaded)
+    {
+        if (reloaded.Pipeline)
+        {
+            vkDestroyPipeline(gContext.Device, reloaded.Pipeline, nullptr);
+        }
+        for (const auto shaderObject : reloaded.ShaderObjects)
+        {
+            vkDestroyShaderEXT(gContext.Device, shaderObject, nullptr);
+        }
+    }
+
+    void DestroyRetired(FrameData& frameData)
+    {
+        for (const auto pipeline : frameData.RetiredPipelines)
+        {
+            vkDestroyPipeline(gContext.Device, pipeline, nullptr);
+        }
+        frameData.RetiredPipelines.clear();
+        for (const auto shaderObject : frameData.RetiredShaderObjects)
+        {
+            vkDestroyShaderEXT(gContext.Device, shaderObject, nullptr);
+        }
+        frameData.RetiredShaderObjects.clear();
+    }
+
+    // Runs on a worker, so it only reads the create info it owns and state
+    // that is fixed after Init
+    std::expected<ReloadedShader,
+                  Error>
+    CompileShader(const ShaderCreateInfo& createInfo,
+                  const std::vector<VkShaderModule>& modules)
+    {
+        const auto stageCode = GetStageCode(createInfo);
+        std::vector<VkSpecializationInfo> specializationInfos;
+        const auto shaderStages =
+            GetShaderStages(stageCode, modules, specializationInfos);
+
+        if (std::holds_alternative<ComputeShaderCreateInfo>(createInfo))
+        {
+            const auto pipelineResult =
+                Vulkan::CreateComputePipeline(gContext.Device,
+                                              gPipelineCache,
+                                              gPipelineLayout,
+                                              shaderStages.front());
+            if (!pipelineResult)
+            {
+                return std::unexpected(pipelineResult.error());
+            }
+            return ReloadedShader{.Pipeline = pipelineResult.value()};
+        }
+
+        if (gContext.Features.ShaderObject)
+        {
+            std::vector<const std::vector<char>*> codes;
+            for (const auto& [code, stage, specialization] : stageCode)
+            {
+                codes.emplace_back(code);
+            }
+            const auto objectsResult =
+                Vulkan::CreateShaderObjects(gContext.Device,
+                                            gDescriptor.Layout,
+                                            shaderStages,
+                                            codes);
+            if (!objectsResult)
+            {
+                return std::unexpected(objectsResult.error());
+            }
+            return ReloadedShader{.ShaderObjects = objectsResult.value()};
+        }
+
+        const auto& graphics = std::get<GraphicsShaderCreateInfo>(createInfo);
+        const auto pipelineResult =
+            Vulkan::CreateGraphicsPipeline(gContext.Device,
+                                           gPipelineCache,
+                                           gPipelineLayout,
+                                           shaderStages,
+                                           graphics,
+                                           gContext.Features);
+        if (!pipelineResult)
+        {
+            return std::unexpected(pipelineResult.error());
+        }
+        return ReloadedShader{.Pipeline = pipelineResult.value()};
+    }
+
+    // Graphics pipelines are shared through the cache, the old one is only
+    // retired once no shader uses it
+    void RetireGraphicsPipeline(FrameData& frameData,
+                                const VkPipeline pipeline)
+    {
+        const bool used =
+            std::ranges::contains(gShaders, pipeline, &Shader::Pipeline) ||
+            std::ranges::contains(gOptimizedPipelines,
+                                  pipeline,
+                                  &OptimizedPipeline::FastLinked);
+        if (used) return;
+        std::erase_if(gGraphicsPipelines,
+                      [pipeline](const auto& entry)
+                      {
+                          return entry.second == pipeline;
+                      });
+        frameData.RetiredPipelines.emplace_back(pipeline);
+    }
+
+    // Swapped in at the frame boundary, frames in flight keep the old
+    // pipeline until this frame slot comes around again
+    void SwapReloadedShaders(FrameData& frameData)
+    {
+        std::erase_if(
+            gPendingReloads,
+            [&frameData](PendingReload& pending)
+            {
+                if (pending.Result.wait_for(std::chrono::seconds(0)) !=
+                    std::future_status::ready)
+                {
+                    return false;
+                }
+                auto result = pending.Result.get();
+                // The compile is done with them either way
+                DestroyShaderModules(pending.Modules);
+                // A failed reload keeps the shader as it was
+                if (!result) return true;
+                auto& reloaded = result.value();
+                if (pending.Superseded)
+                {
+                    DestroyReloadedShader(reloaded);
+                    return true;
+                }
+
+                auto& shader = gShaders.at(pending.Handle);
+                if (shader.BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE)
+                {
+                    frameData.RetiredPipelines.emplace_back(shader.Pipeline);
+                    shader.Pipeline = reloaded.Pipeline;
+                }
+                else if (!reloaded.ShaderObjects.empty())
+                {
+                    std::ranges::copy(
+                        shader.ShaderObjects,
+                        std::back_inserter(frameData.RetiredShaderObjects));
+                    shader.ShaderObjects = std::move(reloaded.ShaderObjects);
+                }
+                else
+                {
+                    const VkPipeline oldPipeline = shader.Pipeline;
+                    shader.Pipeline = reloaded.Pipeline;
+                    RetireGraphicsPipeline(frameData, oldPipeline);
+                }
+                shader.Reflection = std::move(pending.Reflection);
+                gShaderCreateInfos.at(pending.Handle) = *pending.CreateInfo;
+                return true;
+            });
+    }
+
+    // Checked a few times a second, a stat per file is cheap but not free
+    void PollShaderFiles()
+    {
+        constexpr auto pollInterval = std::chrono::milliseconds(250);
+        const auto now = std::chrono::steady_clock::now();
+        if (gWatchedShaderFiles.empty() ||
+            now - gLastShaderFilePoll < pollInterval)
+        {
+            return;
+        }
+        gLastShaderFilePoll = now;
+
+        for (auto& file : gWatchedShaderFiles)
+        {
+            std::error_code error;
+            const auto writeTime =
+                std::filesystem::last_write_time(file.Path, error);
+            if (error || writeTime == file.WriteTime) continue;
+            file.WriteTime = writeTime;
+
+            std::ifstream stream(file.Path, std::ios::binary);
+            std::vector<char> code(std::istreambuf_iterator<char>(stream),
+                                   {});
+            // A half written file fails reflection, the next write retries
+            if (!Swift::ReloadShader(file.Handle, file.Stage, std::move(code)))
+            {
+#ifdef SWIFT_DEBUG
+                std::cerr << "Swift: failed to reload " << file.Path << "\n";
+#endif
+            }
+        }
+    }
+    constexpr uint32_t PipelineListMagic = 0x4C505753;
+    constexpr uint32_t PipelineListVersion = 2;
+    constexpr uint32_t NoStageCode = ~0u;
+    // Written after the version, a list saved before one of these structs
+    // changed no longer loads instead of loading into the wrong fields
+    constexpr std::array<uint32_t,
+                         6>
+        PipelineListLayout{
+            sizeof(GraphicsShaderCreateInfo),
+            sizeof(BlendState),
+            sizeof(DepthStencilState),
+            sizeof(RasterState),
+            sizeof(VkStencilOpState),
+            sizeof(VkSpecializationMapEntry),
+        };
+
+    // Fields are written one by one at fixed widths, enums as uint32_t and
+    // bools as uint8_t, so padding and type sizes never reach the file
+    struct PipelineListWriter
+    {
+        std::vector<char> Bytes;
+
+        template <typename T>
+        void Write(const T& value)
+        {
+            static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>);
+            const auto* bytes = reinterpret_cast<const char*>(&value);
+            Bytes.insert(Bytes.end(), bytes, bytes + sizeof(T));
+        }
+
+        template <typename T>
+        void WriteEnum(const T value)
+        {
+            static_assert(std::is_enum_v<T>);
+            Write(static_cast<uint32_t>(value));
+        }
+
+        void WriteBool(const bool value)
+        {
+            Write(static_cast<uint8_t>(value));
+        }
+
+        template <typename T>
+        void WriteArray(const std::span<const T> values)
+        {
+            static_assert(sizeof(T) == 1);
+            Write(static_cast<uint32_t>(values.size()));
+            const auto* bytes = reinterpret_cast<const char*>(values.data());
+            Bytes.insert(Bytes.end(), bytes, bytes + values.size_bytes());
+        }
+    };
+
+    struct PipelineListReader
+    {
+        std::span<const char> Bytes;
+        bool Failed = false;
+
+        template <typename T>
+        T Read()
+        {
+            static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>);
+            T value{};
+            if (Bytes.size() < sizeof(T))
+            {
+                Failed = true;
+                return value;
+            }
+            std::memcpy(&value, Bytes.data(), sizeof(T));
+            Bytes = Bytes.subspan(sizeof(T));
+            return value;
+        }
+
+        // Values past max are rejected, the enum is never left holding one
+        template <typename T>
+        T ReadEnum(const T max)
+        {
+            static_assert(std::is_enum_v<T>);
+            const auto value = Read<uint32_t>();
+            if (value > static_cast<uint32_t>(max))
+            {
+                Failed = true;
+                return T{};
+            }
+            return static_cast<T>(value);
+        }
+
+        bool ReadBool()
+        {
+            const auto value = Read<uint8_t>();
+            if (value > 1) Failed = true;
+            return value == 1;
+        }
+
+        // Checked against the bytes left, so a corrupt count can't allocate
+        // more than the list holds
+        uint32_t ReadCount()
+        {
+            const auto count = Read<uint32_t>();
+            if (count > Bytes.size()) Failed = true;
+            return Failed ? 0 : count;
+        }
+
+        template <typename T>
+        std::vector<T> ReadArray()
+        {
+            static_assert(sizeof(T) == 1);
+            const auto count = Read<uint32_t>();
+            if (Failed || Bytes.size() < count)
+            {
+                Failed = true;
+                return {};
+            }
+            std::vector<T> values(count);
+            std::memcpy(values.data(), Bytes.data(), count);
+            Bytes = Bytes.subspan(count);
+            return values;
+        }
+    };
+
+    template <typename CreateInfo>
+    auto GetStageFields(CreateInfo& createInfo)
+    {
+        return std::array{
+            std::pair{&createInfo.VertexCode, &createInfo.VertexSpecialization},
+            std::pair{&createInfo.GeometryCode,
+                      &createInfo.GeometrySpecialization},
+            std::pair{&createInfo.FragmentCode,
+                      &createInfo.FragmentSpecialization},
+            std::pair{&createInfo.TaskCode, &createInfo.TaskSpecialization},
+            std::pair{&createInfo.MeshCode, &createInfo.MeshSpecialization},
+        };
+    }
+
+    void WriteStencil(PipelineListWriter& writer,
+                      const VkStencilOpState& stencil)
+    {
+        writer.WriteEnum(stencil.failOp);
+        writer.WriteEnum(stencil.passOp);
+        writer.WriteEnum(stencil.depthFailOp);
+        writer.WriteEnum(stencil.compareOp);
+        writer.Write(stencil.compareMask);
+        writer.Write(stencil.writeMask);
+        writer.Write(stencil.reference);
+    }
+
+    VkStencilOpState ReadStencil(PipelineListReader& reader)
+    {
+        VkStencilOpState stencil{};
+        stencil.failOp = reader.ReadEnum(VK_STENCIL_OP_DECREMENT_AND_WRAP);
+        stencil.passOp = reader.ReadEnum(VK_STENCIL_OP_DECREMENT_AND_WRAP);
+        stencil.depthFailOp = reader.ReadEnum(VK_STENCIL_OP_DECREMENT_AND_WRAP);
+        stencil.compareOp = reader.ReadEnum(VK_COMPARE_OP_ALWAYS);
+        stencil.compareMask = reader.Read<uint32_t>();
+        stencil.writeMask = reader.Read<uint32_t>();
+        stencil.reference = reader.Read<uint32_t>();
+        return stencil;
+    }
+
+    // Only the state baked into the pipeline is written, dynamic state
+    // defaults don't change what the driver compiles
+    void WritePipeline(PipelineListWriter& writer,
+                       const GraphicsShaderCreateInfo& createInfo,
+                       const std::vector<uint32_t>& codeIndices)
+    {
+        const auto stageFields = GetStageFields(createInfo);
+        for (size_t i = 0; i < stageFields.size(); ++i)
+        {
+            const auto& specialization = *stageFields[i].second;
+            writer.Write(codeIndices[i]);
+            writer.WriteArray(std::span<const char>(specialization.EntryPoint));
+            const auto& entries = specialization.Constants.Entries;
+            writer.Write(static_cast<uint32_t>(entries.size()));
+            for (const auto& entry : entries)
+            {
+                writer.Write(entry.constantID);
+                writer.Write(entry.offset);
+                writer.Write(static_cast<uint64_t>(entry.size));
+            }
+            writer.WriteArray(std::span(specialization.Constants.Data));
+        }
+        writer.Write(static_cast<uint32_t>(createInfo.ColorFormats.size()));
+        for (const auto format : createInfo.ColorFormats)
+        {
+            writer.WriteEnum(format);
+        }
+        writer.WriteEnum(createInfo.DepthFormat);
+        writer.WriteEnum(createInfo.Samples);
+        writer.WriteEnum(createInfo.PolygonMode);
+        writer.WriteEnum(createInfo.Topology);
+        writer.Write(static_cast<uint32_t>(createInfo.BlendStates.size()));
+        for (const auto& blend : createInfo.BlendStates)
+        {
+            writer.WriteBool(blend.BlendEnable);
+            writer.WriteEnum(blend.SrcColorFactor);
+            writer.WriteEnum(blend.DstColorFactor);
+            writer.WriteEnum(blend.ColorOp);
+            writer.WriteEnum(blend.SrcAlphaFactor);
+            writer.WriteEnum(blend.DstAlphaFactor);
+            writer.WriteEnum(blend.AlphaOp);
+            writer.Write(blend.WriteMask);
+        }
+        const auto& depthStencil = createInfo.DepthStencil;
+        writer.WriteBool(depthStencil.StencilTest);
+        WriteStencil(writer, depthStencil.StencilFront);
+        WriteStencil(writer, depthStencil.StencilBack);
+        const auto& raster = createInfo.Raster;
+        writer.WriteBool(raster.DepthBiasEnable);
+        writer.Write(raster.DepthBiasConstantFactor);
+        writer.Write(raster.DepthBiasClamp);
+        writer.Write(raster.DepthBiasSlopeFactor);
+        writer.WriteBool(raster.DepthClampEnable);
+    }
+
+    GraphicsShaderCreateInfo
+    ReadPipeline(PipelineListReader& reader,
+                 const std::vector<std::vector<char>>& codes)
+    {
+        GraphicsShaderCreateInfo createInfo;
+        for (auto& [code, specialization] : GetStageFields(createInfo))
+        {
+            const auto codeIndex = reader.Read<uint32_t>();
+            if (codeIndex != NoStageCode)
+            {
+                if (codeIndex >= codes.size())
+                {
+                    reader.Failed = true;
+                    return createInfo;
+                }
+                *code = codes[codeIndex];
+            }
+            const auto entryPoint = reader.ReadArray<char>();
+            specialization->EntryPoint.assign(entryPoint.begin(),
+                                              entryPoint.end());
+            auto& entries = specialization->Constants.Entries;
+            entries.resize(reader.ReadCount());
+            for (auto& entry : entries)
+            {
+                entry.constantID = reader.Read<uint32_t>();
+                entry.offset = reader.Read<uint32_t>();
+                entry.size = reader.Read<uint64_t>();
+            }
+            specialization->Constants.Data = reader.ReadArray<std::byte>();
+            for (const auto& entry : entries)
+            {
+                if (entry.size > specialization->Constants.Data.size() ||
+                    entry.offset > specialization->Constants.Data.size() -
+                                       entry.size)
+                {
+                    reader.Failed = true;
+                }
+            }
+        }
+        // Only core values are accepted, whether the device supports them
+        // is checked before compiling
+        createInfo.ColorFormats.resize(reader.ReadCount());
+        for (auto& format : createInfo.ColorFormats)
+        {
+            format = reader.ReadEnum(VK_FORMAT_ASTC_12x12_SRGB_BLOCK);
+        }
+        createInfo.DepthFormat =
+            reader.ReadEnum(VK_FORMAT_ASTC_12x12_SRGB_BLOCK);
+        createInfo.Samples = reader.ReadEnum(VK_SAMPLE_COUNT_64_BIT);
+        if (!std::has_single_bit(static_cast<uint32_t>(createInfo.Samples)))
+        {
+            reader.Failed = true;
+        }
+        createInfo.PolygonMode = reader.ReadEnum(VK_POLYGON_MODE_POINT);
+        createInfo.Topology = reader.ReadEnum(VK_PRIMITIVE_TOPOLOGY_PATCH_LIST);
+        createInfo.BlendStates.resize(reader.ReadCount());
+        for (auto& blend : createInfo.BlendStates)
+        {
+            blend.BlendEnable = reader.ReadBool();
+            blend.SrcColorFactor =
+                reader.ReadEnum(VK_BLEND_FACTOR_ONE_MINUS_SRC1_ALPHA);
+            blend.DstColorFactor =
+                reader.ReadEnum(VK_BLEND_FACTOR_ONE_MINUS_SRC1_ALPHA);
+            blend.ColorOp = reader.ReadEnum(VK_BLEND_OP_MAX);
+            blend.SrcAlphaFactor =
+                reader.ReadEnum(VK_BLEND_FACTOR_ONE_MINUS_SRC1_ALPHA);
+            blend.DstAlphaFactor =
+                reader.ReadEnum(VK_BLEND_FACTOR_ONE_MINUS_SRC1_ALPHA);
+            blend.AlphaOp = reader.ReadEnum(VK_BLEND_OP_MAX);
+            blend.WriteMask = reader.Read<uint32_t>();
+            if (blend.WriteMask > 0xF) reader.Failed = true;
+        }
+        auto& depthStencil = createInfo.DepthStencil;
+        depthStencil.StencilTest = reader.ReadBool();
+        depthStencil.StencilFront = ReadStencil(reader);
+        depthStencil.StencilBack = ReadStencil(reader);
+        auto& raster = createInfo.Raster;
+        raster.DepthBiasEnable = reader.ReadBool();
+        raster.DepthBiasConstantFactor = reader.Read<float>();
+        raster.DepthBiasClamp = reader.Read<float>();
+        raster.DepthBiasSlopeFactor = reader.Read<float>();
+        raster.DepthClampEnable = reader.ReadBool();
+        return createInfo;
+    }
+
+    // A list can come from another machine, pipelines the device can't
+    // render with are skipped instead of failing the compile
+    bool IsPipelineSupported(const GraphicsShaderCreateInfo& createInfo)
+    {
+        const auto hasFeatures = [](const VkFormat format,
+                                    const VkFormatFeatureFlags features)
+        {
+            VkFormatProperties properties{};
+            vkGetPhysicalDeviceFormatProperties(gContext.GPU,
+                                                format,
+                                                &properties);
+            return (properties.optimalTilingFeatures & features) == features;
+        };
+        const auto& limits = gContext.GPU.properties.limits;
+        for (const auto format : createInfo.ColorFormats)
+        {
+            if (!hasFeatures(format, VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT))
+            {
+                return false;
+            }
+        }
+        if (!createInfo.ColorFormats.empty() &&
+            !(limits.framebufferColorSampleCounts & createInfo.Samples))
+        {
+            return false;
+        }
+        if (createInfo.DepthFormat != VK_FORMAT_UNDEFINED &&
+            (!hasFeatures(createInfo.DepthFormat,
+                          VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) ||
+             !(limits.framebufferDepthSampleCounts & createInfo.Samples)))
+        {
+            return false;
+        }
+        return createInfo.Topology != VK_PRIMITIVE_TOPOLOGY_PATCH_LIST;
+    }
+
+    uint32_t GetQueryPoolIndex(const QueryType type)
+    {
+        return type == QueryType::ePipelineStatistics ? 1 : 0;
+    }
+
+    // The frame's fence was waited on, so every query it ended is available
+    // and reading never blocks
+    void ReadQueryResults(FrameData& frameData)
+    {
+        for (const auto queryHandle : frameData.EndedQueries)
+        {
+            auto& query = gQueries.at(queryHandle);
+            // Values in statistic bit order, then the availability
+            std::array<uint64_t, 4> values{};
+            const bool statistics =
+                query.Type == QueryType::ePipelineStatistics;
+            const uint32_t valueCount = statistics ? 3 : 1;
+            const auto result =
+                vkGetQueryPoolResults(gContext.Device,
+                                      frameData.QueryPools[GetQueryPoolIndex(
+                                          query.Type)],
+                                      query.Slot,
+                                      1,
+                                      sizeof(values),
+                                      values.data(),
+                                      sizeof(values),
+                                      VK_QUERY_RESULT_64_BIT |
+                                          VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+            if (result != VK_SUCCESS || values[valueCount] == 0) continue;
+
+            QueryResult queryResult{.Frame = frameData.FrameNumber};
+            if (statistics)
+            {
+                queryResult.VertexInvocations = values[0];
+                queryResult.ClippingPrimitives = values[1];
+                queryResult.FragmentInvocations = values[2];
+            }
+            else
+            {
+                queryResult.Samples = values[0];
+            }
+            query.Result = queryResult;
+        }
+        frameData.EndedQueries.clear();
+    }
+
+    // Queries have to be reset before use, and reset can't be recorded
+    // inside rendering, so every slot is reset when the frame starts
+    void ResetQueryPools(const FrameData& frameData)
+    {
+        for (uint32_t i = 0; i < frameData.QueryPools.size(); ++i)
+        {
+            if (!frameData.QueryPools[i]) continue;
+            vkCmdResetQueryPool(frameData.Command.Buffer,
+                                frameData.QueryPools[i],
+                                0,
+                                Vulkan::Constants::MaxQueries);
+        }
+    }
+} // namespace
+
+std::expected<void,
+              Error>
+Swift::Init(const InitInfo& info)
+{
+    const auto contextResult = Vulkan::CreateContext(info);
+    if (!contextResult)
+    {
+        return std::unexpected(contextResult.error());
+    }
+    gContext = contextResult.value();
+
+    const auto queueResult =
+        Vulkan::CreateQueue(gContext, vkb::QueueType::graphics);
+    if (!queueResult)
+    {
+        return std::unexpected(queueResult.error());
+    }
+    gGraphicsQueue = queueResult.value();
+
+    const auto transferQueueResult =
+        Vulkan::CreateQueue(gContext, vkb::QueueType::transfer);
+    if (!transferQueueResult)
+    {
+        return std::unexpected(queueResult.error());
+    }
+    gTransferQueue = transferQueueResult.value();
+
+    const auto transferFenceResult = Vulkan::CreateFence(gContext.Device);
+    if (!transferFenceResult)
+    {
+        return std::unexpected(transferFenceResult.error());
+    }
+    gTransferFence = transferFenceResult.value();
+
+    const auto transferCommandResult =
+        Vulkan::CreateCommand(gContext.Device, gTransferQueue.QueueIndex);
+    if (!transferCommandResult)
+    {
+        return std::unexpected(transferCommandResult.error());
+    }
+    gTransferCommand = transferCommandResult.value();
+
+    const auto swapchainResult =
+        Vulkan::CreateSwapchain(gContext, gGraphicsQueue, info.Extent);
+    if (!swapchainResult)
+    {
+        return std::unexpected(swapchainResult.error());
+    }
+    gSwapchain = swapchainResult.value();
+
+    for (auto& frameData : gFrameData)
+    {
+        const auto frameDataResult = Vulkan::CreateFrameData(gContext.Device);
+        if (!frameDataResult)
+        {
+            return std::unexpected(frameDataResult.error());
+        }
+        frameData = frameDataResult.value();
+    }
+
+    const auto descriptorResult = Vulkan::CreateDescriptor(gContext.Device);
+    if (!descriptorResult)
+    {
+        return std::unexpected(descriptorResult.error());
+    }
+    gDescriptor = descriptorResult.value();
+
+    const auto pipelineLayoutResult =
+        Vulkan::CreatePipelineLayout(gContext, gDescriptor.Layout);
+    if (!pipelineLayoutResult)
+    {
+        return std::unexpected(pipelineLayoutResult.error());
+    }
+    gPipelineLayout = pipelineLayoutResult.value();
+
+    const auto pipelineCacheResult =
+        Vulkan::CreatePipelineCache(gContext.Device, info.PipelineCacheData);
+    if (!pipelineCacheResult)
+    {
+        return std::unexpected(pipelineCacheResult.error());
+    }
+    gPipelineCache = pipelineCacheResult.value();
+
+    constexpr SamplerCreateInfo samplerCreateInfo{};
+    const auto samplerResult = Swift::CreateSampler(samplerCreateInfo);
+    if (!samplerResult)
+    {
+        return std::unexpected(samplerResult.error());
+    }
+
+    for (auto& frameData : gFrameData)
+    {
+        const BufferCreateInfo transientCreateInfo{
+            .Usage = BufferUsage::eTransient,
+            .Size = info.TransientBufferSize,
+        };
+        const auto transientResult = Swift::CreateBuffer(transientCreateInfo);
+        if (!transientResult)
+        {
+            return std::unexpected(transientResult.error());
+        }
+        const auto& transientBuffer = gBuffers.at(transientResult.value());
+        frameData.TransientBuffer = transientResult.value();
+        frameData.TransientData = static_cast<std::byte*>(
+            transientBuffer.AllocationInfo.pMappedData);
+        frameData.TransientAddress = transientBuffer.Address;
+        frameData.TransientSize = info.TransientBufferSize;
+    }
+
+    for (auto& frameData : gFrameData)
+    {
+        const auto occlusionPoolResult =
+            Vulkan::CreateQueryPool(gContext.Device, VK_QUERY_TYPE_OCCLUSION);
+        if (!occlusionPoolResult)
+        {
+            return std::unexpected(occlusionPoolResult.error());
+        }
+        frameData.QueryPools[0] = occlusionPoolResult.value();
+
+        if (gContext.Features.PipelineStatistics)
+        {
+            const auto statisticsPoolResult =
+                Vulkan::CreateQueryPool(gContext.Device,
+                                        VK_QUERY_TYPE_PIPELINE_STATISTICS,
+                                        gQueryStatistics);
+            if (!statisticsPoolResult)
+            {
+                return std::unexpected(statisticsPoolResult.error());
+            }
+            frameData.QueryPools[1] = statisticsPoolResult.value();
+        }
+
+        if (gContext.Features.ConditionalRendering)
+        {
+            const BufferCreateInfo predicateCreateInfo{
+                .Usage = BufferUsage::ePredicate,
+                .Size = Vulkan::Constants::MaxQueries * sizeof(uint32_t),
+            };
+            const auto predicateResult = Swift::CreateBuffer(predicateCreateInfo);
+            if (!predicateResult)
+            {
+                return std::unexpected(predicateResult.error());
+            }
+            frameData.PredicateBuffer = predicateResult.value();
+        }
+    }
+
+    return {};
+}
+
+void Swift::Shutdown()
+{
+    vkDeviceWaitIdle(gContext.Device);
+
+    for (const auto& sampler : gSamplers)
+    {
+        vkDestroySampler(gContext.Device, sampler, nullptr);
+    }
+
+    for (auto& image : gImages)
+    {
+        if (!image.ImageView) continue;
+        Vulkan::DestroyImage(gContext, image);
+    }
+
+    for (auto& tempImage : gTempImages)
+    {
+        if (!tempImage.BaseImage) continue;
+        Vulkan::DestroyImage(gContext, tempImage);
+    }
+
+    for (auto& pool : gBufferPools)
+    {
+        for (const auto& block : pool.Blocks)
+        {
+            vmaClearVirtualBlock(block.VirtualBlock);
+            vmaDestroyVirtualBlock(block.VirtualBlock);
+        }
+        pool.Blocks.clear();
+    }
+
+    for (auto& buffer : gBuffers)
+    {
+        if (!buffer.Allocation) continue;
+        Vulkan::DestroyBuffer(gContext.Allocator, buffer);
+    }
+
+    for (const auto& shader : gShaders)
+    {
+        if (shader.BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE)
+        {
+            vkDestroyPipeline(gContext.Device, shader.Pipeline, nullptr);
+        }
+    }
+    for (auto& pending : gOptimizedPipelines)
+    {
+        const auto optimizedResult = pending.Optimized.get();
+        if (optimizedResult)
+        {
+            vkDestroyPipeline(gContext.Device, optimizedResult.value(), nullptr);
+        }
+    }
+    gOptimizedPipelines.clear();
+    // Every queued link was waited on above, so the workers are idle
+    gLinkWorkers.Threads.clear();
+    for (auto& pending : gPendingReloads)
+    {
+        const auto reloadedResult = pending.Result.get();
+        if (reloadedResult)
+        {
+            DestroyReloadedShader(reloadedResult.value());
+        }
+        DestroyShaderModules(pending.Modules);
+    }
+    gPendingReloads.clear();
+    gWatchedShaderFiles.clear();
+    for (auto& frameData : gFrameData)
+    {
+        DestroyRetired(frameData);
+    }
+    // Reloaded pipelines aren't cached, so shaders are checked too
+    std::unordered_set<VkPipeline> graphicsPipelines;
+    for (const auto& pipeline : gGraphicsPipelines | std::views::values)
+    {
+        graphicsPipelines.emplace(pipeline);
+    }
+    for (const auto& shader : gShaders)
+    {
+        if (shader.BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS &&
+            shader.Pipeline)
+        {
+            graphicsPipelines.emplace(shader.Pipeline);
+        }
+    }
+    for (const auto pipeline : graphicsPipelines)
+    {
+        vkDestroyPipeline(gContext.Device, pipeline, nullptr);
+    }
+    for (const auto& library : gPipelineLibraries | std::views::values)
+    {
+        vkDestroyPipeline(gContext.Device, library, nullptr);
+    }
+    gPipelineLibraries.clear();
+    for (const auto& shader : gShaders)
+    {
+        for (const auto shaderObject : shader.ShaderObjects)
+        {
+            vkDestroyShaderEXT(gContext.Device, shaderObject, nullptr);
+        }
+    }
+    vkDestroyPipelineLayout(gContext.Device, gPipelineLayout, nullptr);
+    vkDestroyPipelineCache(gContext.Device, gPipelineCache, nullptr);
+    gPipelineRecords.clear();
+    for (const auto& shaderModule : gShaderModules | std::views::values)
+    {
+        vkDestroyShaderModule(gContext.Device, shaderModule, nullptr);
+    }
+    gShaderModules.clear();
+    gGraphicsPipelines.clear();
+    gShaderCreateInfos.clear();
+
+    for (const auto& frameData : gFrameData)
+    {
+        vkDestroyCommandPool(gContext.Device, frameData.Command.Pool, nullptr);
+        vkDestroySemaphore(gContext.Device, frameData.ImageAvailable, nullptr);
+        vkDestroySemaphore(gContext.Device, frameData.RenderFinished, nullptr);
+        vkDestroyFence(gContext.Device, frameData.Fence, nullptr);
+    }
+
+    for (const auto& frameData : gFrameData)
+    {
+        for (const auto queryPool : frameData.QueryPools)
+        {
+            if (!queryPool) continue;
+            vkDestroyQueryPool(gContext.Device, queryPool, nullptr);
+        }
+    }
+    gQueries.clear();
+    gQuerySlots = {};
+
+    vkDestroyFence(gContext.Device, gTransferFence, nullptr);
+    vkDestroyCommandPool(gContext.Device, gTransferCommand.Pool, nullptr);
+    vkDestroyDescriptorPool(gContext.Device, gDescriptor.Pool, nullptr);
+    vkDestroyDescriptorSetLayout(gContext.Device, gDescriptor.Layout, nullptr);
+
+    for (const auto& image : gSwapchain.Images)
+    {
+        vkDestroyImageView(gContext.Device, image.ImageView, nullptr);
+    }
+    Vulkan::DestroyImage(gContext, gSwapchain.DepthImage);
+    vkDestroySwapchainKHR(gContext.Device, gSwapchain.SwapChain, nullptr);
+    vmaDestroyAllocator(gContext.Allocator);
+    vkb::destroy_device(gContext.Device);
+    vkDestroySurfaceKHR(gContext.Instance, gContext.Surface, nullptr);
+    vkb::destroy_instance(gContext.Instance);
+}
+
+std::expected<void,
+              Error>
+Swift::BeginFrame(const DynamicInfo& info)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto result = Vulkan::WaitFence(gContext.Device, currentFrameData.Fence);
+    if (!result)
+    {
+        return std::unexpected(result.error());
+    }
+    currentFrameData.TransientOffset = 0;
+    currentFrameData.State = {};
+    ++gFrameNumber;
+    ReadQueryResults(currentFrameData);
+    currentFrameData.FrameNumber = gFrameNumber;
+    DestroyRetired(currentFrameData);
+    SwapOptimizedPipelines(currentFrameData);
+    PollShaderFiles();
+    SwapReloadedShaders(currentFrameData);
+
+    if (info.Extent != gSwapchain.Dimensions)
+    {
+        const auto swapchainResult = Vulkan::RecreateSwapchain(gContext,
+            gGraphicsQueue,
+            gSwapchain,
+            info.Extent);
+        if (!swapchainResult)
+        {
+            return std::unexpected(swapchainResult.error());
+        }
+    }
+
+    const auto acquireResult =
+        Vulkan::AcquireNextImage(gContext,
+                                 gSwapchain,
+                                 currentFrameData.ImageAvailable);
+
+    result = Vulkan::ResetFence(gContext.Device, currentFrameData.Fence);
+    if (!result)
+    {
+        return std::unexpected(result.error());
+    }
+
+    if (!acquireResult)
+    {
+        const auto swapchainResult = Vulkan::RecreateSwapchain(gContext,
+            gGraphicsQueue,
+            gSwapchain,
+            info.Extent);
+        if (!swapchainResult)
+        {
+            return std::unexpected(swapchainResult.error());
+        }
+    }
+    gSwapchain.CurrentImageIndex = acquireResult.value();
+
+    Vulkan::BeginCommandBuffer(currentFrameData.Command);
+    ResetQueryPools(currentFrameData);
+
+    return {};
+}
+
+std::expected<void,
+              Error>
+Swift::EndFrame(const DynamicInfo& info)
+{
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    const auto& command = currentFrameData.Command;
+
+    auto& image = Vulkan::GetSwapchainImage(gSwapchain);
+
+    const auto presentTransition =
+        Vulkan::TransitionImage(image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    Vulkan::PipelineBarrier(command.Buffer, {presentTransition});
+    Vulkan::EndCommandBuffer(command);
+
+    const SubmitInfo submitInfo{
+        .WaitSemaphore = currentFrameData.ImageAvailable,
+        .WaitPipelineStage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .SignalSemaphore = currentFrameData.RenderFinished,
+        .SignalPipelineStage = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
+        .Fence = currentFrameData.Fence,
+    };
+    Vulkan::SubmitQueue(gGraphicsQueue, command, submitInfo);
+
+    if (!Vulkan::Present(gSwapchain,
+                         gGraphicsQueue,
+                         currentFrameData.RenderFinished))
+    {
+        const auto swapchainResult = Vulkan::RecreateSwapchain(gContext,
+            gGraphicsQueue,
+            gSwapchain,
+            info.Extent);
+        if (!swapchainResult)
+        {
+            return std::unexpected(swapchainResult.error());
+        }
+    }
+
+    gCurrentFrame = (gCurrentFrame + 1) % gFrameData.size();
+    return {};
+}
+
+void Swift::BeginRendering()
+{
+    FlushDeferredTransitions();
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto& swapchainImage = Vulkan::GetSwapchainImage(gSwapchain);
+    const auto renderTransition =
+        Vulkan::TransitionImage(swapchainImage,
+                                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    const auto depthTransition =
+        Vulkan::TransitionImage(swapchainImage,
+                                VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+    Vulkan::PipelineBarrier(currentFrameData.Command.Buffer,
+                            {renderTransition, depthTransition});
+
+    const VkRenderingAttachmentInfo colorInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageView = swapchainImage.ImageView,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+    };
+
+    const VkRenderingAttachmentInfo depthInfo{
         .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
         .imageView = gSwapchain.DepthImage.ImageView,
         .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
@@ -305,10 +1939,12 @@ void Swift::BeginRendering()
                            {colorInfo},
                            depthInfo,
                            gSwapchain.Dimensions);
+    gRendering = true;
 }
 
 void Swift::BeginRendering(const BeginRenderInfo& renderInfo)
 {
+    FlushDeferredTransitions();
     const auto& currentFrameData = gFrameData.at(gCurrentFrame);
     auto& shader = gShaders.at(gCurrentShader);
 
@@ -344,6 +1980,7 @@ void Swift::BeginRendering(const BeginRenderInfo& renderInfo)
             Vulkan::TransitionImage(realImage,
                                     VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
     }
+    bool stencil = false;
     if (renderInfo.DepthAttachment != InvalidHandle)
     {
         VkAttachmentLoadOp depthLoadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
@@ -367,12 +2004,17 @@ void Swift::BeginRendering(const BeginRenderInfo& renderInfo)
             break;
         }
         auto& depthImage = gImages.at(renderInfo.DepthAttachment);
+        stencil = Vulkan::HasStencil(depthImage.Format);
+        const auto depthLayout =
+            stencil ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+                    : VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
         shader.DepthAttachment.imageView = depthImage.ImageView;
+        shader.DepthAttachment.imageLayout = depthLayout;
         shader.DepthAttachment.loadOp = depthLoadOp;
         shader.DepthAttachment.storeOp = depthStoreOp;
         imageBarriers.emplace_back(
             Vulkan::TransitionImage(depthImage,
-                                    VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+                                    depthLayout,
                                     VK_IMAGE_ASPECT_DEPTH_BIT));
     }
     Vulkan::PipelineBarrier(currentFrameData.Command.Buffer, {imageBarriers});
@@ -380,41 +2022,124 @@ void Swift::BeginRendering(const BeginRenderInfo& renderInfo)
     Vulkan::BeginRendering(currentFrameData.Command,
                            shader.ColorAttachments,
                            shader.DepthAttachment,
-                           renderInfo.Dimensions);
+                           renderInfo.Dimensions,
+                           stencil);
+    gRendering = true;
 }
 
 void Swift::EndRendering()
 {
     const auto& currentFrameData = gFrameData.at(gCurrentFrame);
     Vulkan::EndRendering(currentFrameData.Command);
+    gRendering = false;
 }
 
 void Swift::BindShader(const ShaderHandle& shaderHandle)
 {
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto& state = currentFrameData.State;
     const auto& shader = gShaders.at(shaderHandle);
     gCurrentShader = shaderHandle;
-    vkCmdBindPipeline(currentFrameData.Command.Buffer,
-                      shader.BindPoint,
-                      shader.Pipeline);
-    vkCmdBindDescriptorSets(currentFrameData.Command.Buffer,
-                            shader.BindPoint,
-                            gPipelineLayout,
-                            0,
-                            1,
-                            &gDescriptor.Set,
-                            0,
-                            nullptr);
+
+    // Every pipeline shares one layout, so the set stays bound across
+    // pipeline changes
+    const auto bindPoint =
+        shader.BindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? 1 : 0;
+    if (!shader.ShaderObjects.empty())
+    {
+        if (state.ShaderObjects != shaderHandle)
+        {
+            BindShaderObjects(shader);
+            state.ShaderObjects = shaderHandle;
+            state.Pipelines[bindPoint] = nullptr;
+        }
+    }
+    else if (state.Pipelines[bindPoint] != shader.Pipeline)
+    {
+        vkCmdBindPipeline(currentFrameData.Command.Buffer,
+                          shader.BindPoint,
+                          shader.Pipeline);
+        state.Pipelines[bindPoint] = shader.Pipeline;
+        if (bindPoint == 0)
+        {
+            // Static pipeline state replaces what shader objects set
+            state.ShaderObjects = InvalidHandle;
+            state.ShaderObjectDefaults = false;
+        }
+    }
+    // Shaders that only reach memory through addresses never need the set
+    if (!state.DescriptorSetBound[bindPoint] &&
+        shader.Reflection.BindingMask != 0)
+    {
+        vkCmdBindDescriptorSets(currentFrameData.Command.Buffer,
+                                shader.BindPoint,
+                                gPipelineLayout,
+                                0,
+                                1,
+                                &gDescriptor.Set,
+                                0,
+                                nullptr);
+        state.DescriptorSetBound[bindPoint] = true;
+    }
+
+    const auto& depthStencil = shader.DepthStencil;
+    if (depthStencil.DepthTest) SetDepthTest(*depthStencil.DepthTest);
+    if (depthStencil.DepthWrite) SetDepthWrite(*depthStencil.DepthWrite);
+    if (depthStencil.DepthCompareOp)
+    {
+        SetDepthCompareOp(*depthStencil.DepthCompareOp);
+    }
+    if (shader.Raster.CullMode) SetCullMode(*shader.Raster.CullMode);
+    if (shader.Raster.FrontFace) SetFrontFace(*shader.Raster.FrontFace);
+
+    // Pipelines leave this state dynamic, so every bind has to provide it
+    if (HasDynamicState3() &&
+        shader.BindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
+    {
+        SetPolygonMode(shader.PolygonMode);
+        SetRasterizationSamples(shader.Samples);
+        SetDepthClamp(shader.Raster.DepthClampEnable);
+        for (uint32_t i = 0; i < shader.BlendStates.size(); ++i)
+        {
+            SetBlendState(shader.BlendStates[i], i);
+        }
+    }
+    if (!shader.ShaderObjects.empty())
+    {
+        SetShaderObjectState(shader);
+    }
 }
 
-void Swift::BindIndexBuffer(const BufferHandle bufferHandle)
+std::expected<void,
+              Error>
+Swift::BindIndexBuffer(const BufferHandle bufferHandle,
+                       const uint64_t offset,
+                       const IndexType indexType)
 {
     const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    const auto& buffer = gBuffers.at(bufferHandle);
+    auto& buffer = gBuffers.at(bufferHandle);
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    TrackBufferAccess(barriers,
+                      bufferHandle,
+                      VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT,
+                      VK_ACCESS_2_INDEX_READ_BIT);
+    if (!FlushBufferBarriers(barriers))
+    {
+        return std::unexpected(Error::eBarrierInsideRendering);
+    }
     vkCmdBindIndexBuffer(currentFrameData.Command.Buffer,
                          buffer.BaseBuffer,
-                         0,
-                         VK_INDEX_TYPE_UINT32);
+                         GetBufferOffset(buffer) + offset,
+                         static_cast<VkIndexType>(indexType));
+    return {};
+}
+
+std::expected<void,
+              Error>
+Swift::BindIndexBuffer(const BufferSlice& slice,
+                       const IndexType indexType)
+{
+    return BindIndexBuffer(slice.Buffer, slice.Offset, indexType);
 }
 
 void Swift::DispatchCompute(const uint32_t groupX,
@@ -425,6 +2150,44 @@ void Swift::DispatchCompute(const uint32_t groupX,
     vkCmdDispatch(currentFrameData.Command.Buffer, groupX, groupY, groupZ);
 }
 
+void Swift::DispatchComputeThreads(const uint32_t threadX,
+                                   const uint32_t threadY,
+                                   const uint32_t threadZ)
+{
+    const auto& localSize = gShaders.at(gCurrentShader).Reflection.LocalSize;
+    const auto groupCount = [](const uint32_t threads,
+                               const uint32_t groupSize)
+    {
+        const uint32_t size = std::max(groupSize, 1u);
+        return (threads + size - 1) / size;
+    };
+    DispatchCompute(groupCount(threadX, localSize[0]),
+                    groupCount(threadY, localSize[1]),
+                    groupCount(threadZ, localSize[2]));
+}
+
+std::expected<void,
+              Error>
+Swift::DispatchComputeIndirect(const BufferHandle bufferHandle,
+                               const uint64_t offset)
+{
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto& buffer = gBuffers.at(bufferHandle);
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    TrackBufferAccess(barriers,
+                      bufferHandle,
+                      VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                      VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+    if (!FlushBufferBarriers(barriers))
+    {
+        return std::unexpected(Error::eBarrierInsideRendering);
+    }
+    vkCmdDispatchIndirect(currentFrameData.Command.Buffer,
+                          buffer.BaseBuffer,
+                          GetBufferOffset(buffer) + offset);
+    return {};
+}
+
 void Swift::Draw(const uint32_t vertexCount,
                  const uint32_t instanceCount,
                  const uint32_t firstVertex,
@@ -453,37 +2216,209 @@ void Swift::DrawIndexed(const uint32_t indexCount,
                      firstInstance);
 }
 
-void Swift::DrawIndexedIndirect(const BufferHandle& bufferHandle,
-                                const uint64_t offset,
-                                const uint32_t drawCount,
-                                const uint32_t stride)
+void Swift::MultiDraw(const std::span<const DrawRange> draws,
+                      const uint32_t instanceCount,
+                      const uint32_t firstInstance)
+{
+    static_assert(sizeof(DrawRange) == sizeof(VkMultiDrawInfoEXT));
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (!gContext.Features.MultiDraw)
+    {
+        for (const auto& [firstVertex, vertexCount] : draws)
+        {
+            vkCmdDraw(currentFrameData.Command.Buffer,
+                      vertexCount,
+                      instanceCount,
+                      firstVertex,
+                      firstInstance);
+        }
+        return;
+    }
+
+    const auto maxCount = gContext.Features.MaxMultiDrawCount;
+    for (size_t first = 0; first < draws.size(); first += maxCount)
+    {
+        const auto count = std::min<size_t>(maxCount, draws.size() - first);
+        vkCmdDrawMultiEXT(
+            currentFrameData.Command.Buffer,
+            static_cast<uint32_t>(count),
+            reinterpret_cast<const VkMultiDrawInfoEXT*>(draws.data() + first),
+            instanceCount,
+            firstInstance,
+            sizeof(DrawRange));
+    }
+}
+
+void Swift::MultiDrawIndexed(const std::span<const IndexedDrawRange> draws,
+                             const uint32_t instanceCount,
+                             const uint32_t firstInstance)
+{
+    static_assert(sizeof(IndexedDrawRange) ==
+                  sizeof(VkMultiDrawIndexedInfoEXT));
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (!gContext.Features.MultiDraw)
+    {
+        for (const auto& [firstIndex, indexCount, vertexOffset] : draws)
+        {
+            vkCmdDrawIndexed(currentFrameData.Command.Buffer,
+                             indexCount,
+                             instanceCount,
+                             firstIndex,
+                             vertexOffset,
+                             firstInstance);
+        }
+        return;
+    }
+
+    const auto maxCount = gContext.Features.MaxMultiDrawCount;
+    for (size_t first = 0; first < draws.size(); first += maxCount)
+    {
+        const auto count = std::min<size_t>(maxCount, draws.size() - first);
+        // A null vertex offset makes every range use its own
+        vkCmdDrawMultiIndexedEXT(
+            currentFrameData.Command.Buffer,
+            static_cast<uint32_t>(count),
+            reinterpret_cast<const VkMultiDrawIndexedInfoEXT*>(draws.data() +
+                                                               first),
+            instanceCount,
+            firstInstance,
+            sizeof(IndexedDrawRange),
+            nullptr);
+    }
+}
+
+std::expected<void,
+              Error>
+Swift::DrawIndexedIndirect(const BufferHandle& bufferHandle,
+                           const uint64_t offset,
+                           const uint32_t drawCount,
+                           const uint32_t stride)
 {
     const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    const auto& buffer = gBuffers.at(bufferHandle);
+    auto& buffer = gBuffers.at(bufferHandle);
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    TrackBufferAccess(barriers,
+                      bufferHandle,
+                      VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                      VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+    if (!FlushBufferBarriers(barriers))
+    {
+        return std::unexpected(Error::eBarrierInsideRendering);
+    }
     vkCmdDrawIndexedIndirect(currentFrameData.Command.Buffer,
                              buffer.BaseBuffer,
-                             offset,
+                             GetBufferOffset(buffer) + offset,
                              drawCount,
                              stride);
+    return {};
 }
 
-void Swift::DrawIndexedIndirectCount(const BufferHandle& bufferHandle,
-                                     const uint64_t offset,
-                                     const BufferHandle& countBufferHandle,
-                                     const uint64_t countOffset,
-                                     const uint32_t maxDrawCount,
-                                     const uint32_t stride)
+std::expected<void,
+              Error>
+Swift::DrawIndexedIndirectCount(const BufferHandle& bufferHandle,
+                                const uint64_t offset,
+                                const BufferHandle& countBufferHandle,
+                                const uint64_t countOffset,
+                                const uint32_t maxDrawCount,
+                                const uint32_t stride)
 {
     const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    const auto& buffer = gBuffers.at(bufferHandle);
-    const auto& countBuffer = gBuffers.at(countBufferHandle);
+    auto& buffer = gBuffers.at(bufferHandle);
+    auto& countBuffer = gBuffers.at(countBufferHandle);
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    TrackBufferAccess(barriers,
+                      bufferHandle,
+                      VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                      VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+    TrackBufferAccess(barriers,
+                      countBufferHandle,
+                      VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                      VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+    if (!FlushBufferBarriers(barriers))
+    {
+        return std::unexpected(Error::eBarrierInsideRendering);
+    }
     vkCmdDrawIndexedIndirectCount(currentFrameData.Command.Buffer,
                                   buffer.BaseBuffer,
-                                  offset,
+                                  GetBufferOffset(buffer) + offset,
                                   countBuffer.BaseBuffer,
-                                  countOffset,
+                                  GetBufferOffset(countBuffer) + countOffset,
                                   maxDrawCount,
                                   stride);
+    return {};
+}
+
+void Swift::DrawMeshTasks(const uint32_t groupX,
+                          const uint32_t groupY,
+                          const uint32_t groupZ)
+{
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    vkCmdDrawMeshTasksEXT(currentFrameData.Command.Buffer,
+                          groupX,
+                          groupY,
+                          groupZ);
+}
+
+std::expected<void,
+              Error>
+Swift::DrawMeshTasksIndirect(const BufferHandle& bufferHandle,
+                             const uint64_t offset,
+                             const uint32_t drawCount,
+                             const uint32_t stride)
+{
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto& buffer = gBuffers.at(bufferHandle);
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    TrackBufferAccess(barriers,
+                      bufferHandle,
+                      VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                      VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+    if (!FlushBufferBarriers(barriers))
+    {
+        return std::unexpected(Error::eBarrierInsideRendering);
+    }
+    vkCmdDrawMeshTasksIndirectEXT(currentFrameData.Command.Buffer,
+                                  buffer.BaseBuffer,
+                                  GetBufferOffset(buffer) + offset,
+                                  drawCount,
+                                  stride);
+    return {};
+}
+
+std::expected<void,
+              Error>
+Swift::DrawMeshTasksIndirectCount(const BufferHandle& bufferHandle,
+                                  const uint64_t offset,
+                                  const BufferHandle& countBufferHandle,
+                                  const uint64_t countOffset,
+                                  const uint32_t maxDrawCount,
+                                  const uint32_t stride)
+{
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto& buffer = gBuffers.at(bufferHandle);
+    auto& countBuffer = gBuffers.at(countBufferHandle);
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    TrackBufferAccess(barriers,
+                      bufferHandle,
+                      VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                      VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+    TrackBufferAccess(barriers,
+                      countBufferHandle,
+                      VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                      VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+    if (!FlushBufferBarriers(barriers))
+    {
+        return std::unexpected(Error::eBarrierInsideRendering);
+    }
+    vkCmdDrawMeshTasksIndirectCountEXT(currentFrameData.Command.Buffer,
+                                       buffer.BaseBuffer,
+                                       GetBufferOffset(buffer) + offset,
+                                       countBuffer.BaseBuffer,
+                                       GetBufferOffset(countBuffer) +
+                                           countOffset,
+                                       maxDrawCount,
+                                       stride);
+    return {};
 }
 
 void Swift::ClearSwapchain(const Float4 color)
@@ -511,6 +2446,14 @@ void Swift::PushConstant(const void* data,
                          const uint32_t size,
                          const uint32_t offset)
 {
+#ifdef SWIFT_DEBUG
+    if (offset + size > Vulkan::Constants::PushConstantSize)
+    {
+        std::cerr << "Swift: push constant range ends past "
+                  << Vulkan::Constants::PushConstantSize << " bytes\n";
+        return;
+    }
+#endif
     const auto& currentFrameData = gFrameData.at(gCurrentFrame);
     vkCmdPushConstants(currentFrameData.Command.Buffer,
                        gPipelineLayout,
@@ -522,7 +2465,12 @@ void Swift::PushConstant(const void* data,
 
 void Swift::SetViewport(const ViewportInfo& viewportInfo)
 {
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (currentFrameData.State.Viewport == viewportInfo)
+    {
+        return;
+    }
+    currentFrameData.State.Viewport = viewportInfo;
     gViewports.clear();
     auto& [x, y, width, height, minDepth, maxDepth] = gViewports.emplace_back();
     width = static_cast<float>(viewportInfo.Extent.x);
@@ -538,7 +2486,12 @@ void Swift::SetViewport(const ViewportInfo& viewportInfo)
 
 void Swift::SetScissor(const ViewportInfo& viewportInfo)
 {
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (currentFrameData.State.Scissor == viewportInfo)
+    {
+        return;
+    }
+    currentFrameData.State.Scissor = viewportInfo;
     gScissors.clear();
 
     auto& scissor = gScissors.emplace_back();
@@ -550,199 +2503,835 @@ void Swift::SetScissor(const ViewportInfo& viewportInfo)
                              gScissors.data());
 }
 
-void Swift::SetCullMode(CullMode cullMode)
+void Swift::SetPolygonMode(const PolygonMode polygonMode)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (!HasDynamicState3() ||
+        currentFrameData.State.PolygonMode == polygonMode)
+    {
+        return;
+    }
+    currentFrameData.State.PolygonMode = polygonMode;
+    vkCmdSetPolygonModeEXT(currentFrameData.Command.Buffer,
+                           static_cast<VkPolygonMode>(polygonMode));
+}
+
+void Swift::SetRasterizationSamples(const VkSampleCountFlagBits samples)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (!HasDynamicState3() ||
+        currentFrameData.State.Samples == samples)
+    {
+        return;
+    }
+    currentFrameData.State.Samples = samples;
+    vkCmdSetRasterizationSamplesEXT(currentFrameData.Command.Buffer, samples);
+}
+
+void Swift::SetBlendState(const BlendState& blendState,
+                          const uint32_t attachment)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto& blendStates = currentFrameData.State.BlendStates;
+    if (!HasDynamicState3())
+    {
+        return;
+    }
+    if (blendStates.size() <= attachment)
+    {
+        blendStates.resize(attachment + 1);
+    }
+    if (blendStates[attachment] == blendState)
+    {
+        return;
+    }
+    blendStates[attachment] = blendState;
+
+    const auto& commandBuffer = currentFrameData.Command.Buffer;
+    const VkBool32 blendEnable = blendState.BlendEnable;
+    vkCmdSetColorBlendEnableEXT(commandBuffer, attachment, 1, &blendEnable);
+    const VkColorBlendEquationEXT equation{
+        .srcColorBlendFactor = blendState.SrcColorFactor,
+        .dstColorBlendFactor = blendState.DstColorFactor,
+        .colorBlendOp = blendState.ColorOp,
+        .srcAlphaBlendFactor = blendState.SrcAlphaFactor,
+        .dstAlphaBlendFactor = blendState.DstAlphaFactor,
+        .alphaBlendOp = blendState.AlphaOp,
+    };
+    vkCmdSetColorBlendEquationEXT(commandBuffer, attachment, 1, &equation);
+    vkCmdSetColorWriteMaskEXT(commandBuffer,
+                              attachment,
+                              1,
+                              &blendState.WriteMask);
+}
+
+void Swift::SetDepthClamp(const bool depthClamp)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (!HasDynamicState3() ||
+        !gContext.Features.DepthClamp ||
+        currentFrameData.State.DepthClamp == depthClamp)
+    {
+        return;
+    }
+    currentFrameData.State.DepthClamp = depthClamp;
+    vkCmdSetDepthClampEnableEXT(currentFrameData.Command.Buffer, depthClamp);
+}
+
+void Swift::SetCullMode(CullMode cullMode)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (currentFrameData.State.CullMode == cullMode)
+    {
+        return;
+    }
+    currentFrameData.State.CullMode = cullMode;
+    vkCmdSetCullMode(currentFrameData.Command.Buffer,
+                     static_cast<VkCullModeFlags>(cullMode));
+}
+
+void Swift::SetDepthTest(const bool depthTest)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (currentFrameData.State.DepthTest == depthTest)
+    {
+        return;
+    }
+    currentFrameData.State.DepthTest = depthTest;
+    vkCmdSetDepthTestEnable(currentFrameData.Command.Buffer, depthTest);
+}
+
+void Swift::SetDepthWrite(const bool depthWrite)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (currentFrameData.State.DepthWrite == depthWrite)
+    {
+        return;
+    }
+    currentFrameData.State.DepthWrite = depthWrite;
+    vkCmdSetDepthWriteEnable(currentFrameData.Command.Buffer, depthWrite);
+}
+
+void Swift::SetDepthCompareOp(DepthCompareOp depthCompareOp)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (currentFrameData.State.DepthCompareOp == depthCompareOp)
+    {
+        return;
+    }
+    currentFrameData.State.DepthCompareOp = depthCompareOp;
+    vkCmdSetDepthCompareOp(currentFrameData.Command.Buffer,
+                           static_cast<VkCompareOp>(depthCompareOp));
+}
+
+void Swift::SetFrontFace(FrontFace frontFace)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (currentFrameData.State.FrontFace == frontFace)
+    {
+        return;
+    }
+    currentFrameData.State.FrontFace = frontFace;
+    vkCmdSetFrontFace(currentFrameData.Command.Buffer,
+                      static_cast<VkFrontFace>(frontFace));
+}
+
+void Swift::SetLineWidth(const float lineWidth)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (currentFrameData.State.LineWidth == lineWidth)
+    {
+        return;
+    }
+    currentFrameData.State.LineWidth = lineWidth;
+    vkCmdSetLineWidth(currentFrameData.Command.Buffer, lineWidth);
+}
+
+void Swift::SetTopology(Topology topology)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    if (currentFrameData.State.Topology == topology)
+    {
+        return;
+    }
+    currentFrameData.State.Topology = topology;
+    vkCmdSetPrimitiveTopology(currentFrameData.Command.Buffer,
+                              static_cast<VkPrimitiveTopology>(topology));
+}
+
+void Swift::Resolve(const ImageHandle srcImageHandle,
+                    const ImageHandle resolvedImageHandle)
+{
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto& srcImage = gImages.at(srcImageHandle);
+    auto& resolvedImage = gImages.at(resolvedImageHandle);
+    const auto& extent = VkExtent3D(srcImage.Extent.x, srcImage.Extent.y, 1);
+    const auto transferSrcTransition =
+        Vulkan::TransitionImage(srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    const auto transferDstTransition =
+        Vulkan::TransitionImage(resolvedImage,
+                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    Vulkan::PipelineBarrier(currentFrameData.Command.Buffer,
+                            {transferSrcTransition, transferDstTransition});
+    Vulkan::ResolveImage(currentFrameData.Command.Buffer,
+                         srcImage.BaseImage,
+                         resolvedImage.BaseImage,
+                         extent);
+}
+
+std::expected<ShaderHandle,
+              Error>
+Swift::CreateGraphicsShader(const GraphicsShaderCreateInfo& createInfo)
+{
+    const auto stageCode = GetStageCode(createInfo);
+    auto reflectionResult = ReflectStages(stageCode);
+    if (!reflectionResult)
+    {
+        return std::unexpected(reflectionResult.error());
+    }
+
+    VkPipeline pipeline = nullptr;
+    std::vector<VkShaderEXT> shaderObjects;
+    std::vector<VkShaderStageFlagBits> shaderObjectStages;
+    std::vector<VkSpecializationInfo> specializationInfos;
+    if (gContext.Features.ShaderObject)
+    {
+        // Shader objects are made straight from the code, so no module is
+        // created and no pipeline key built
+        const auto shaderStages = GetShaderStages(
+            stageCode,
+            std::vector<VkShaderModule>(stageCode.size()),
+            specializationInfos);
+        std::vector<const std::vector<char>*> codes;
+        for (const auto& [code, stage, specialization] : stageCode)
+        {
+            codes.emplace_back(code);
+        }
+        const auto objectsResult =
+            Vulkan::CreateShaderObjects(gContext.Device,
+                                        gDescriptor.Layout,
+                                        shaderStages,
+                                        codes);
+        if (!objectsResult)
+        {
+            return std::unexpected(objectsResult.error());
+        }
+        shaderObjects = objectsResult.value();
+        for (const auto& stage : shaderStages)
+        {
+            shaderObjectStages.emplace_back(stage.stage);
+        }
+    }
+    else
+    {
+        const auto modulesResult = GetShaderModules(stageCode);
+        if (!modulesResult)
+        {
+            return std::unexpected(modulesResult.error());
+        }
+        const auto shaderStages = GetShaderStages(
+            stageCode, modulesResult.value(), specializationInfos);
+        const auto pipelineKey =
+            GetGraphicsPipelineKey(createInfo, shaderStages);
+        if (const auto it = gGraphicsPipelines.find(pipelineKey);
+            it != gGraphicsPipelines.end())
+        {
+            pipeline = it->second;
+        }
+        else if (gContext.Features.GraphicsPipelineLibrary)
+        {
+            const auto pipelineResult =
+                CreateLinkedPipeline(createInfo, shaderStages, pipelineKey);
+            if (!pipelineResult)
+            {
+                return std::unexpected(pipelineResult.error());
+            }
+            pipeline = pipelineResult.value();
+            gGraphicsPipelines.emplace(pipelineKey, pipeline);
+        }
+        else
+        {
+            VkPipelineCreationFeedback feedback{};
+            const auto start = std::chrono::steady_clock::now();
+            const auto pipelineResult =
+                Vulkan::CreateGraphicsPipeline(gContext.Device,
+                                               gPipelineCache,
+                                               gPipelineLayout,
+                                               shaderStages,
+                                               createInfo,
+                                               gContext.Features,
+                                               0,
+                                               &feedback);
+            if (!pipelineResult)
+            {
+                return std::unexpected(pipelineResult.error());
+            }
+            RecordPipeline(GetPipelineHash(pipelineKey),
+                           feedback,
+                           std::chrono::steady_clock::now() - start,
+                           false);
+            pipeline = pipelineResult.value();
+            gGraphicsPipelines.emplace(pipelineKey, pipeline);
+        }
+    }
+
+    constexpr VkRenderingAttachmentInfo colorInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = VkClearValue{0.f, 0.f, 0.f, 0.f}};
+
+    constexpr VkRenderingAttachmentInfo depthInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = {.depthStencil = {1.f, 0}}};
+
+    const std::vector colorAttachments{createInfo.ColorFormats.size(),
+                                       colorInfo};
+
+    std::vector<BlendState> blendStates(createInfo.ColorFormats.size());
+    std::ranges::copy_n(createInfo.BlendStates.begin(),
+                        std::min(createInfo.BlendStates.size(),
+                                 blendStates.size()),
+                        blendStates.begin());
+
+    const uint32_t shaderHandle = gShaders.size();
+    gShaders.emplace_back(Shader{
+        pipeline,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        colorAttachments,
+        depthInfo,
+        std::move(reflectionResult.value()),
+        createInfo.DepthStencil,
+        createInfo.Raster,
+        std::move(blendStates),
+        static_cast<PolygonMode>(createInfo.PolygonMode),
+        createInfo.Samples,
+        static_cast<Topology>(createInfo.Topology),
+        std::move(shaderObjects),
+        std::move(shaderObjectStages),
+    });
+    gShaderCreateInfos.emplace_back(createInfo);
+    return shaderHandle;
+}
+
+std::expected<ShaderHandle,
+              Error>
+Swift::CreateComputeShader(const ComputeShaderCreateInfo& createInfo)
+{
+    const auto stageCode = GetStageCode(createInfo);
+    auto reflectionResult = ReflectStages(stageCode);
+    if (!reflectionResult)
+    {
+        return std::unexpected(reflectionResult.error());
+    }
+    const auto modulesResult = GetShaderModules(stageCode);
+    if (!modulesResult)
+    {
+        return std::unexpected(modulesResult.error());
+    }
+    std::vector<VkSpecializationInfo> specializationInfos;
+    const auto shaderStages =
+        GetShaderStages(stageCode, modulesResult.value(), specializationInfos);
+    VkPipelineCreationFeedback feedback{};
+    const auto start = std::chrono::steady_clock::now();
+    const auto computePipelineResult =
+        Vulkan::CreateComputePipeline(gContext.Device,
+                                      gPipelineCache,
+                                      gPipelineLayout,
+                                      shaderStages.front(),
+                                      &feedback);
+    if (!computePipelineResult)
+    {
+        return std::unexpected(computePipelineResult.error());
+    }
+    PipelineKey pipelineKey;
+    AppendStageKey(pipelineKey, shaderStages.front());
+    RecordPipeline(GetPipelineHash(pipelineKey),
+                   feedback,
+                   std::chrono::steady_clock::now() - start,
+                   false);
+
+    const uint32_t shaderHandle = gShaders.size();
+    gShaders.emplace_back(Shader{
+        computePipelineResult.value(),
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        {},
+        {},
+        std::move(reflectionResult.value()),
+    });
+    gShaderCreateInfos.emplace_back(createInfo);
+    return shaderHandle;
+}
+
+std::expected<void,
+              Error>
+Swift::ReloadShader(const ShaderHandle shaderHandle,
+                    const ShaderStage stage,
+                    std::vector<char> code)
+{
+    // Builds on the newest code of the shader, reloads still compiling
+    // included
+    const auto pending =
+        std::ranges::find_last(gPendingReloads,
+                               shaderHandle,
+                               &PendingReload::Handle);
+    auto createInfo = std::make_shared<ShaderCreateInfo>(
+        pending.empty() ? gShaderCreateInfos.at(shaderHandle)
+                        : *pending.front().CreateInfo);
+
+    auto* stageField = GetStageCodeField(*createInfo, stage);
+    const auto stageCode = GetStageCode(*createInfo);
+    const bool hasStage =
+        std::ranges::any_of(stageCode,
+                            [stage](const StageCode& entry)
+                            {
+                                return std::get<ShaderStage>(entry) == stage;
+                            });
+    if (!stageField || !hasStage)
+    {
+        return std::unexpected(Error::eShaderCreateFailed);
+    }
+    *stageField = std::move(code);
+
+    // Reflection and modules are cheap next to the pipeline compile and
+    // share state with the render thread, so only the compile moves off it
+    auto reflectionResult = ReflectStages(stageCode);
+    if (!reflectionResult)
+    {
+        return std::unexpected(reflectionResult.error());
+    }
+    std::vector<VkShaderModule> modules;
+    for (const auto& [code, stage, specialization] : stageCode)
+    {
+        const auto moduleResult =
+            Vulkan::CreateShaderModule(gContext.Device, *code);
+        if (!moduleResult)
+        {
+            DestroyShaderModules(modules);
+            return std::unexpected(moduleResult.error());
+        }
+        modules.emplace_back(moduleResult.value());
+    }
+
+    for (auto& reload : gPendingReloads)
+    {
+        if (reload.Handle == shaderHandle) reload.Superseded = true;
+    }
+    gPendingReloads.emplace_back(PendingReload{
+        .Handle = shaderHandle,
+        .CreateInfo = createInfo,
+        .Reflection = std::move(reflectionResult.value()),
+        .Modules = modules,
+        .Result = std::async(std::launch::async,
+                             [createInfo, modules]
+                             {
+                                 return CompileShader(*createInfo, modules);
+                             }),
+    });
+    return {};
+}
+
+void Swift::WatchShaderFile(const ShaderHandle shaderHandle,
+                            const ShaderStage stage,
+                            const std::filesystem::path& path)
 {
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    vkCmdSetCullMode(currentFrameData.Command.Buffer,
-                     static_cast<VkCullModeFlags>(cullMode));
+    std::error_code error;
+    gWatchedShaderFiles.emplace_back(WatchedShaderFile{
+        .Handle = shaderHandle,
+        .Stage = stage,
+        .Path = path,
+        .WriteTime = std::filesystem::last_write_time(path, error),
+    });
 }
 
-void Swift::SetDepthTest(const bool depthTest)
+void Swift::UnwatchShaderFiles(const ShaderHandle shaderHandle)
 {
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    vkCmdSetDepthTestEnable(currentFrameData.Command.Buffer, depthTest);
+    std::erase_if(gWatchedShaderFiles,
+                  [shaderHandle](const WatchedShaderFile& file)
+                  {
+                      return file.Handle == shaderHandle;
+                  });
 }
 
-void Swift::SetDepthWrite(const bool depthWrite)
+std::span<const PipelineRecord> Swift::GetPipelineRecords()
 {
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    vkCmdSetDepthWriteEnable(currentFrameData.Command.Buffer, depthWrite);
+    return gPipelineRecords;
 }
 
-void Swift::SetDepthCompareOp(DepthCompareOp depthCompareOp)
+std::vector<char> Swift::GetPipelineCacheData()
 {
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    vkCmdSetDepthCompareOp(currentFrameData.Command.Buffer,
-                           static_cast<VkCompareOp>(depthCompareOp));
+    return Vulkan::GetPipelineCacheData(gContext.Device, gPipelineCache);
 }
 
-void Swift::SetFrontFace(FrontFace frontFace)
+std::expected<void,
+              Error>
+Swift::SavePipelineList(const std::filesystem::path& path)
 {
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    vkCmdSetFrontFace(currentFrameData.Command.Buffer,
-                      static_cast<VkFrontFace>(frontFace));
-}
+    // SPIR-V is shared by many pipelines, so it is stored once and the
+    // pipelines refer to it by index
+    std::vector<const std::vector<char>*> codes;
+    std::unordered_map<std::string_view,
+                       uint32_t>
+        codeIndices;
+    std::unordered_set<PipelineKey> pipelineKeys;
+    PipelineListWriter pipelineWriter;
+    uint32_t pipelineCount = 0;
+    // Reloaded code isn't in gShaderModules, it gets modules that only live
+    // until the keys are built. They stay alive until then so no two stages
+    // share a handle
+    std::vector<VkShaderModule> temporaryModules;
+
+    for (const auto& shaderCreateInfo : gShaderCreateInfos)
+    {
+        const auto* createInfo =
+            std::get_if<GraphicsShaderCreateInfo>(&shaderCreateInfo);
+        if (!createInfo) continue;
 
-void Swift::SetLineWidth(const float lineWidth)
-{
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    vkCmdSetLineWidth(currentFrameData.Command.Buffer, lineWidth);
-}
+        const auto stageCode = GetStageCode(*createInfo);
+        std::vector<VkShaderModule> modules;
+        for (const auto& [code, stage, specialization] : stageCode)
+        {
+            if (const auto it = gShaderModules.find(
+                    std::string_view(code->data(), code->size()));
+                it != gShaderModules.end())
+            {
+                modules.emplace_back(it->second);
+                continue;
+            }
+            const auto moduleResult =
+                Vulkan::CreateShaderModule(gContext.Device, *code);
+            if (!moduleResult)
+            {
+                DestroyShaderModules(temporaryModules);
+                return std::unexpected(moduleResult.error());
+            }
+            temporaryModules.emplace_back(moduleResult.value());
+            modules.emplace_back(moduleResult.value());
+        }
+        std::vector<VkSpecializationInfo> specializationInfos;
+        const auto shaderStages =
+            GetShaderStages(stageCode, modules, specializationInfos);
+        auto pipelineKey = GetGraphicsPipelineKey(*createInfo, shaderStages);
+        const uint64_t pipelineHash = GetPipelineHash(pipelineKey);
+        if (!pipelineKeys.emplace(std::move(pipelineKey)).second) continue;
+
+        std::vector<uint32_t> stageCodeIndices;
+        for (const auto& [code, specialization] : GetStageFields(*createInfo))
+        {
+            if (code->empty())
+            {
+                stageCodeIndices.emplace_back(NoStageCode);
+                continue;
+            }
+            const auto [it, inserted] = codeIndices.try_emplace(
+                std::string_view(code->data(), code->size()),
+                static_cast<uint32_t>(codes.size()));
+            if (inserted) codes.emplace_back(code);
+            stageCodeIndices.emplace_back(it->second);
+        }
 
-void Swift::SetTopology(Topology topology)
-{
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    vkCmdSetPrimitiveTopology(currentFrameData.Command.Buffer,
-                              static_cast<VkPrimitiveTopology>(topology));
-}
+        // The slowest compile seen this run, replay starts with those
+        uint64_t durationNs = 0;
+        for (const auto& record : gPipelineRecords)
+        {
+            if (record.Hash != pipelineHash) continue;
+            durationNs = std::max(durationNs, record.DurationNs);
+        }
+        pipelineWriter.Write(durationNs);
+        WritePipeline(pipelineWriter, *createInfo, stageCodeIndices);
+        ++pipelineCount;
+    }
+    DestroyShaderModules(temporaryModules);
 
-void Swift::Resolve(const ImageHandle srcImageHandle,
-                    const ImageHandle resolvedImageHandle)
-{
-    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    auto& srcImage = gImages.at(srcImageHandle);
-    auto& resolvedImage = gImages.at(resolvedImageHandle);
-    const auto& extent = VkExtent3D(srcImage.Extent.x, srcImage.Extent.y, 1);
-    const auto transferSrcTransition =
-        Vulkan::TransitionImage(srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-    const auto transferDstTransition =
-        Vulkan::TransitionImage(resolvedImage,
-                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    Vulkan::PipelineBarrier(currentFrameData.Command.Buffer,
-                            {transferSrcTransition, transferDstTransition});
-    Vulkan::ResolveImage(currentFrameData.Command.Buffer,
-                         srcImage.BaseImage,
-                         resolvedImage.BaseImage,
-                         extent);
+    PipelineListWriter writer;
+    writer.Write(PipelineListMagic);
+    writer.Write(PipelineListVersion);
+    for (const auto size : PipelineListLayout)
+    {
+        writer.Write(size);
+    }
+    writer.Write(static_cast<uint32_t>(codes.size()));
+    for (const auto* code : codes)
+    {
+        writer.WriteArray(std::span<const char>(*code));
+    }
+    writer.Write(pipelineCount);
+    writer.Bytes.insert(writer.Bytes.end(),
+                        pipelineWriter.Bytes.begin(),
+                        pipelineWriter.Bytes.end());
+
+    std::ofstream stream(path, std::ios::binary);
+    stream.write(writer.Bytes.data(),
+                 static_cast<std::streamsize>(writer.Bytes.size()));
+    if (!stream)
+    {
+        return std::unexpected(Error::ePipelineListFailed);
+    }
+    return {};
 }
 
-std::expected<ShaderHandle,
+std::expected<uint32_t,
               Error>
-Swift::CreateGraphicsShader(const GraphicsShaderCreateInfo& createInfo)
+Swift::ReplayPipelineList(const std::filesystem::path& path,
+                          uint32_t threadCount)
 {
-    const auto vertexShaderResult = Vulkan::CreateShader(gContext.Device,
-        createInfo.VertexCode,
-        ShaderStage::eVertex);
-    if (!vertexShaderResult)
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
     {
-        return std::unexpected(vertexShaderResult.error());
+        return std::unexpected(Error::ePipelineListFailed);
     }
-    const auto [vertShaderModule, vertShaderStage] = vertexShaderResult.value();
+    const std::vector<char> bytes(std::istreambuf_iterator<char>(stream), {});
 
-    VkShaderModule geomShaderModule = nullptr;
-    VkPipelineShaderStageCreateInfo geomShaderStage;
-    if (!createInfo.GeometryCode.empty())
+    PipelineListReader reader{bytes};
+    if (reader.Read<uint32_t>() != PipelineListMagic ||
+        reader.Read<uint32_t>() != PipelineListVersion)
     {
-        auto geomShaderResult =
-            Vulkan::CreateShader(gContext.Device,
-                                 createInfo.GeometryCode,
-                                 ShaderStage::eGeometry);
-        if (!geomShaderResult)
+        return std::unexpected(Error::ePipelineListFailed);
+    }
+    for (const auto size : PipelineListLayout)
+    {
+        if (reader.Read<uint32_t>() != size)
         {
-            return std::unexpected(geomShaderResult.error());
+            return std::unexpected(Error::ePipelineListFailed);
         }
-        const auto [geomModule, geomStage] = geomShaderResult.value();
-        geomShaderModule = geomModule;
-        geomShaderStage = geomStage;
     }
-
-    const auto fragmentShaderResult =
-        Vulkan::CreateShader(gContext.Device,
-                             createInfo.FragmentCode,
-                             ShaderStage::eFragment);
-    if (!fragmentShaderResult)
+    const auto codeCount = reader.ReadCount();
+    if (reader.Failed)
     {
-        return std::unexpected(fragmentShaderResult.error());
+        return std::unexpected(Error::ePipelineListFailed);
     }
-    const auto [fragShaderModule, fragShaderStage] =
-        fragmentShaderResult.value();
-
-    std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
-    if (geomShaderModule)
+    std::vector<std::vector<char>> codes(codeCount);
+    for (auto& code : codes)
     {
-        shaderStages.emplace_back(vertShaderStage);
-        shaderStages.emplace_back(geomShaderStage);
-        shaderStages.emplace_back(fragShaderStage);
+        code = reader.ReadArray<char>();
     }
-    else
+    struct ReplayJob
+    {
+        GraphicsShaderCreateInfo CreateInfo;
+        uint64_t DurationNs;
+        PipelineKey Key;
+        std::vector<VkShaderModule> Modules;
+        std::expected<VkPipeline,
+                      Error>
+            Result = std::unexpected(Error::ePipelineCreateFailed);
+        VkPipelineCreationFeedback Feedback{};
+        std::chrono::nanoseconds CpuTime{};
+    };
+    const auto pipelineCount = reader.ReadCount();
+    if (reader.Failed)
+    {
+        return std::unexpected(Error::ePipelineListFailed);
+    }
+    std::vector<ReplayJob> jobs(pipelineCount);
+    for (auto& job : jobs)
+    {
+        job.DurationNs = reader.Read<uint64_t>();
+        job.CreateInfo = ReadPipeline(reader, codes);
+    }
+    if (reader.Failed)
+    {
+        return std::unexpected(Error::ePipelineListFailed);
+    }
+    // Shader objects bake no state, there is nothing to warm up
+    if (gContext.Features.ShaderObject) return 0;
+
+    // Modules and hashes touch the caches, so they are resolved here and
+    // the workers only compile
+    std::unordered_set<PipelineKey> pipelineKeys;
+    std::erase_if(
+        jobs,
+        [&pipelineKeys](ReplayJob& job)
+        {
+            if (!IsPipelineSupported(job.CreateInfo)) return true;
+            const auto stageCode = GetStageCode(job.CreateInfo);
+            if (!ReflectStages(stageCode)) return true;
+            auto modulesResult = GetShaderModules(stageCode);
+            if (!modulesResult) return true;
+            job.Modules = std::move(modulesResult.value());
+            std::vector<VkSpecializationInfo> specializationInfos;
+            const auto shaderStages =
+                GetShaderStages(stageCode, job.Modules, specializationInfos);
+            job.Key = GetGraphicsPipelineKey(job.CreateInfo, shaderStages);
+            return gGraphicsPipelines.contains(job.Key) ||
+                   !pipelineKeys.emplace(job.Key).second;
+        });
+    // Slowest first, so a long compile doesn't start last and hold up
+    // every other worker
+    std::ranges::sort(jobs, std::ranges::greater{}, &ReplayJob::DurationNs);
+
+    if (threadCount == 0)
     {
-        shaderStages.emplace_back(vertShaderStage);
-        shaderStages.emplace_back(fragShaderStage);
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
     }
-    const auto pipelineResult =
-        Vulkan::CreateGraphicsPipeline(gContext.Device,
-                                       gPipelineLayout,
-                                       shaderStages,
-                                       createInfo);
-    if (!pipelineResult)
+    threadCount = std::min(threadCount, static_cast<uint32_t>(jobs.size()));
+    std::atomic<size_t> nextJob = 0;
+    const auto work = [&jobs, &nextJob]
+    {
+        for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+        {
+            auto& job = jobs[i];
+            const auto stageCode = GetStageCode(job.CreateInfo);
+            std::vector<VkSpecializationInfo> specializationInfos;
+            const auto shaderStages =
+                GetShaderStages(stageCode, job.Modules, specializationInfos);
+            const auto start = std::chrono::steady_clock::now();
+            job.Result = Vulkan::CreateGraphicsPipeline(gContext.Device,
+                                                        gPipelineCache,
+                                                        gPipelineLayout,
+                                                        shaderStages,
+                                                        job.CreateInfo,
+                                                        gContext.Features,
+                                                        0,
+                                                        &job.Feedback);
+            job.CpuTime = std::chrono::steady_clock::now() - start;
+        }
+    };
     {
-        return std::unexpected(pipelineResult.error());
+        std::vector<std::jthread> workers;
+        for (uint32_t i = 1; i < threadCount; ++i)
+        {
+            workers.emplace_back(work);
+        }
+        work();
     }
 
-    vkDestroyShaderModule(gContext.Device, vertShaderModule, nullptr);
-    vkDestroyShaderModule(gContext.Device, fragShaderModule, nullptr);
-    if (geomShaderModule)
+    uint32_t replayedCount = 0;
+    for (const auto& job : jobs)
     {
-        vkDestroyShaderModule(gContext.Device, geomShaderModule, nullptr);
+        if (!job.Result) continue;
+        gGraphicsPipelines.emplace(job.Key, job.Result.value());
+        RecordPipeline(GetPipelineHash(job.Key),
+                       job.Feedback,
+                       job.CpuTime,
+                       true);
+        ++replayedCount;
     }
+    return replayedCount;
+}
 
-    constexpr VkRenderingAttachmentInfo colorInfo{
-        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-        .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
-        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-        .clearValue = VkClearValue{0.f, 0.f, 0.f, 0.f}};
+const ShaderReflection&
+Swift::GetShaderReflection(const ShaderHandle shaderHandle)
+{
+    return gShaders.at(shaderHandle).Reflection;
+}
 
-    constexpr VkRenderingAttachmentInfo depthInfo{
-        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
-        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-        .clearValue = VkClearValue{1.f, 1.f, 1.f, 1.f}};
+std::expected<QueryHandle,
+              Error>
+Swift::CreateQuery(const QueryType type)
+{
+    const bool supported =
+        (type != QueryType::eOcclusion || gContext.Features.PreciseOcclusion) &&
+        (type != QueryType::ePipelineStatistics ||
+         gContext.Features.PipelineStatistics);
+    auto& slots = gQuerySlots[GetQueryPoolIndex(type)];
+    if (!supported || slots == Vulkan::Constants::MaxQueries)
+    {
+        return std::unexpected(Error::eQueryCreateFailed);
+    }
+    gQueries.emplace_back(Query{type, slots++});
+    return static_cast<uint32_t>(gQueries.size() - 1);
+}
 
-    const std::vector colorAttachments{createInfo.ColorFormats.size(),
-                                       colorInfo};
+void Swift::BeginQuery(const QueryHandle queryHandle)
+{
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    const auto& query = gQueries.at(queryHandle);
+    vkCmdBeginQuery(currentFrameData.Command.Buffer,
+                    currentFrameData.QueryPools[GetQueryPoolIndex(query.Type)],
+                    query.Slot,
+                    query.Type == QueryType::eOcclusion
+                        ? VK_QUERY_CONTROL_PRECISE_BIT
+                        : VkQueryControlFlags{});
+}
 
-    const uint32_t shaderHandle = gShaders.size();
-    gShaders.emplace_back(Shader{
-        pipelineResult.value(),
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        colorAttachments,
-        depthInfo,
-    });
-    return shaderHandle;
+void Swift::EndQuery(const QueryHandle queryHandle)
+{
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    const auto& query = gQueries.at(queryHandle);
+    vkCmdEndQuery(currentFrameData.Command.Buffer,
+                  currentFrameData.QueryPools[GetQueryPoolIndex(query.Type)],
+                  query.Slot);
+    currentFrameData.EndedQueries.emplace_back(queryHandle);
 }
 
-std::expected<ShaderHandle,
-              Error>
-Swift::CreateComputeShader(const ComputeShaderCreateInfo& createInfo)
+std::optional<QueryResult> Swift::GetQueryResult(const QueryHandle queryHandle)
+{
+    return gQueries.at(queryHandle).Result;
+}
+
+void Swift::BeginConditionalRendering(const QueryHandle queryHandle,
+                                      const bool inverted)
 {
-    const auto computeShaderResult =
-        Vulkan::CreateShader(gContext.Device,
-                             createInfo.ComputeCode,
-                             ShaderStage::eCompute);
-    if (!computeShaderResult)
+    if (!gContext.Features.ConditionalRendering) return;
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    const auto& query = gQueries.at(queryHandle);
+    auto& predicate = gBuffers.at(currentFrameData.PredicateBuffer);
+    const uint64_t offset = query.Slot * sizeof(uint32_t);
+    // The predicate is copied first, which rendering doesn't allow
+    if (gRendering)
     {
-        return std::unexpected(computeShaderResult.error());
+#ifdef SWIFT_DEBUG
+        std::cerr << "Swift: BeginConditionalRendering was called inside "
+                     "rendering\n";
+#endif
+        return;
     }
-    const auto [computeShaderModule, computeShaderStage] =
-        computeShaderResult.value();
-    const auto computePipelineResult =
-        Vulkan::CreateComputePipeline(gContext.Device,
-                                      gPipelineLayout,
-                                      computeShaderStage);
-    if (!computePipelineResult)
+    // Copying a query that never ran this frame would wait forever
+    if (query.Type == QueryType::ePipelineStatistics ||
+        !std::ranges::contains(currentFrameData.EndedQueries, queryHandle))
     {
-        return std::unexpected(computePipelineResult.error());
+#ifdef SWIFT_DEBUG
+        std::cerr << "Swift: conditional rendering needs an occlusion query "
+                     "ended earlier this frame\n";
+#endif
+        return;
     }
 
-    vkDestroyShaderModule(gContext.Device, computeShaderModule, nullptr);
-    const uint32_t shaderHandle = gShaders.size();
-    gShaders.emplace_back(Shader{
-        computePipelineResult.value(),
-        VK_PIPELINE_BIND_POINT_COMPUTE,
-    });
-    return shaderHandle;
+    // The predicate is the 32 bit sample count, copied on the GPU so the
+    // CPU never waits on the query
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    TrackBufferAccess(barriers,
+                      currentFrameData.PredicateBuffer,
+                      VK_PIPELINE_STAGE_2_COPY_BIT,
+                      VK_ACCESS_2_TRANSFER_WRITE_BIT);
+    if (!FlushBufferBarriers(barriers)) return;
+    vkCmdCopyQueryPoolResults(currentFrameData.Command.Buffer,
+                              currentFrameData.QueryPools[0],
+                              query.Slot,
+                              1,
+                              predicate.BaseBuffer,
+                              offset,
+                              sizeof(uint32_t),
+                              VK_QUERY_RESULT_WAIT_BIT);
+    barriers.clear();
+    TrackBufferAccess(barriers,
+                      currentFrameData.PredicateBuffer,
+                      VK_PIPELINE_STAGE_2_CONDITIONAL_RENDERING_BIT_EXT,
+                      VK_ACCESS_2_CONDITIONAL_RENDERING_READ_BIT_EXT);
+    if (!FlushBufferBarriers(barriers)) return;
+
+    const VkConditionalRenderingBeginInfoEXT beginInfo{
+        .sType = VK_STRUCTURE_TYPE_CONDITIONAL_RENDERING_BEGIN_INFO_EXT,
+        .buffer = predicate.BaseBuffer,
+        .offset = offset,
+        .flags = inverted ? VK_CONDITIONAL_RENDERING_INVERTED_BIT_EXT
+                          : VkConditionalRenderingFlagsEXT{},
+    };
+    vkCmdBeginConditionalRenderingEXT(currentFrameData.Command.Buffer,
+                                      &beginInfo);
+    gConditionalRendering = true;
+}
+
+void Swift::EndConditionalRendering()
+{
+    if (!gConditionalRendering) return;
+    gConditionalRendering = false;
+    vkCmdEndConditionalRenderingEXT(
+        gFrameData.at(gCurrentFrame).Command.Buffer);
 }
 
 void Swift::BlitImage(const ImageHandle srcImageHandle,
@@ -847,7 +3436,12 @@ Swift::MapBuffer(const BufferHandle bufferHandle)
     }
 #endif
     const auto& buffer = gBuffers.at(bufferHandle);
-    return Vulkan::MapBuffer(gContext, buffer);
+    const auto result = Vulkan::MapBuffer(gContext, buffer);
+    if (!result)
+    {
+        return std::unexpected(result.error());
+    }
+    return static_cast<std::byte*>(result.value()) + GetBufferOffset(buffer);
 }
 
 void Swift::UnmapBuffer(const BufferHandle bufferHandle)
@@ -856,10 +3450,10 @@ void Swift::UnmapBuffer(const BufferHandle bufferHandle)
     Vulkan::UnmapBuffer(gContext, buffer);
 }
 
-uint64_t Swift::GetBufferAddress(BufferHandle bufferHandle)
+uint64_t Swift::GetBufferAddress(const BufferHandle bufferHandle)
 {
-    auto& buffer = gBuffers.at(bufferHandle);
-    return Vulkan::GetBufferAddress(gContext.Device, buffer.BaseBuffer);
+    const auto& buffer = gBuffers.at(bufferHandle);
+    return buffer.Address + GetBufferOffset(buffer);
 }
 
 void Swift::CopyBuffer(const BufferHandle srcHandle,
@@ -867,13 +3461,30 @@ void Swift::CopyBuffer(const BufferHandle srcHandle,
                        const std::vector<BufferCopy>& copyRegions)
 {
     const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    const auto& srcBuffer = gBuffers.at(srcHandle);
-    const auto& dstBuffer = gBuffers.at(dstHandle);
-
+    auto& srcBuffer = gBuffers.at(srcHandle);
+    auto& dstBuffer = gBuffers.at(dstHandle);
+
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    TrackBufferAccess(barriers,
+                      srcHandle,
+                      VK_PIPELINE_STAGE_2_COPY_BIT,
+                      VK_ACCESS_2_TRANSFER_READ_BIT);
+    TrackBufferAccess(barriers,
+                      dstHandle,
+                      VK_PIPELINE_STAGE_2_COPY_BIT,
+                      VK_ACCESS_2_TRANSFER_WRITE_BIT);
+    if (!FlushBufferBarriers(barriers)) return;
+
+    std::vector<BufferCopy> regions = copyRegions;
+    for (auto& region : regions)
+    {
+        region.SrcOffset += GetBufferOffset(srcBuffer);
+        region.DstOffset += GetBufferOffset(dstBuffer);
+    }
     Vulkan::CopyBuffer(currentFrameData.Command.Buffer,
                        srcBuffer.BaseBuffer,
                        dstBuffer.BaseBuffer,
-                       copyRegions);
+                       regions);
 }
 
 void Swift::UpdateBuffer(const BufferHandle bufferHandle,
@@ -882,14 +3493,213 @@ void Swift::UpdateBuffer(const BufferHandle bufferHandle,
                          const uint64_t size)
 {
     const auto& currentFrameData = gFrameData.at(gCurrentFrame);
-    const auto& buffer = gBuffers.at(bufferHandle);
+    auto& buffer = gBuffers.at(bufferHandle);
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    TrackBufferAccess(barriers,
+                      bufferHandle,
+                      VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                      VK_ACCESS_2_TRANSFER_WRITE_BIT);
+    if (!FlushBufferBarriers(barriers)) return;
     Vulkan::UpdateBuffer(currentFrameData.Command.Buffer,
                          buffer.BaseBuffer,
                          data,
-                         offset,
+                         GetBufferOffset(buffer) + offset,
                          size);
 }
 
+void Swift::FillBuffer(const BufferHandle bufferHandle,
+                       const uint32_t value,
+                       const uint64_t offset,
+                       uint64_t size)
+{
+    const auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    auto& buffer = gBuffers.at(bufferHandle);
+    if (buffer.Dynamic && size == VK_WHOLE_SIZE)
+    {
+        size = buffer.VersionStride - offset;
+    }
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    TrackBufferAccess(barriers,
+                      bufferHandle,
+                      VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                      VK_ACCESS_2_TRANSFER_WRITE_BIT);
+    if (!FlushBufferBarriers(barriers)) return;
+    Vulkan::FillBuffer(currentFrameData.Command.Buffer,
+                       buffer.BaseBuffer,
+                       value,
+                       GetBufferOffset(buffer) + offset,
+                       size);
+}
+
+std::expected<TransientAllocation,
+              Error>
+Swift::AllocateTransient(const uint64_t size,
+                         const uint64_t alignment)
+{
+    // The mask below only rounds up to powers of two, zero would round every
+    // allocation down to the start of the buffer
+    if (!std::has_single_bit(alignment))
+    {
+        return std::unexpected(Error::eInvalidArgument);
+    }
+    auto& currentFrameData = gFrameData.at(gCurrentFrame);
+    const uint64_t offset =
+        (currentFrameData.TransientOffset + alignment - 1) & ~(alignment - 1);
+    if (offset + size > currentFrameData.TransientSize)
+    {
+        return std::unexpected(Error::eOutOfTransientMemory);
+    }
+    currentFrameData.TransientOffset = offset + size;
+    return TransientAllocation{
+        .Data = currentFrameData.TransientData + offset,
+        .Address = currentFrameData.TransientAddress + offset,
+        .Buffer = currentFrameData.TransientBuffer,
+        .Offset = offset,
+    };
+}
+
+std::expected<BufferPoolHandle,
+              Error>
+Swift::CreateBufferPool(const BufferPoolCreateInfo& createInfo)
+{
+    BufferPool pool{
+        .Usage = createInfo.Usage,
+        .BlockSize = createInfo.BlockSize,
+    };
+    const auto blockResult = CreatePoolBlock(pool, pool.BlockSize);
+    if (!blockResult)
+    {
+        return std::unexpected(blockResult.error());
+    }
+    pool.Blocks.emplace_back(blockResult.value());
+    gBufferPools.emplace_back(std::move(pool));
+    return static_cast<uint32_t>(gBufferPools.size() - 1);
+}
+
+void Swift::DestroyBufferPool(const BufferPoolHandle poolHandle)
+{
+    auto& pool = gBufferPools.at(poolHandle);
+    for (const auto& block : pool.Blocks)
+    {
+        vmaClearVirtualBlock(block.VirtualBlock);
+        vmaDestroyVirtualBlock(block.VirtualBlock);
+        Swift::DestroyBuffer(block.Buffer);
+    }
+    pool.Blocks.clear();
+}
+
+std::expected<BufferSlice,
+              Error>
+Swift::AllocateSlice(const BufferPoolHandle poolHandle,
+                     const uint64_t size,
+                     const uint64_t alignment)
+{
+    auto& pool = gBufferPools.at(poolHandle);
+    const VmaVirtualAllocationCreateInfo allocationCreateInfo{
+        .size = size,
+        .alignment = alignment,
+    };
+
+    VmaVirtualAllocation allocation{};
+    VkDeviceSize offset = 0;
+    auto blockIt = std::ranges::find_if(
+        pool.Blocks,
+        [&](const BufferPoolBlock& block)
+        {
+            return vmaVirtualAllocate(block.VirtualBlock,
+                                      &allocationCreateInfo,
+                                      &allocation,
+                                      &offset) == VK_SUCCESS;
+        });
+    if (blockIt == pool.Blocks.end())
+    {
+        const auto blockResult =
+            CreatePoolBlock(pool, std::max(pool.BlockSize, size));
+        if (!blockResult)
+        {
+            return std::unexpected(blockResult.error());
+        }
+        pool.Blocks.emplace_back(blockResult.value());
+        blockIt = std::prev(pool.Blocks.end());
+        const auto result = vmaVirtualAllocate(blockIt->VirtualBlock,
+                                               &allocationCreateInfo,
+                                               &allocation,
+                                               &offset);
+        if (result != VK_SUCCESS)
+        {
+            return std::unexpected(Error::eBufferCreateFailed);
+        }
+    }
+
+    const auto& buffer = gBuffers.at(blockIt->Buffer);
+    return BufferSlice{
+        .Buffer = blockIt->Buffer,
+        .Offset = offset,
+        .Size = size,
+        .Address = buffer.Address + offset,
+        .Data = static_cast<std::byte*>(buffer.AllocationInfo.pMappedData) +
+                offset,
+        .Allocation = allocation,
+    };
+}
+
+void Swift::FreeSlice(const BufferPoolHandle poolHandle,
+                      const BufferSlice& slice)
+{
+    const auto& pool = gBufferPools.at(poolHandle);
+    const auto blockIt =
+        std::ranges::find(pool.Blocks, slice.Buffer, &BufferPoolBlock::Buffer);
+    if (blockIt == pool.Blocks.end()) return;
+    vmaVirtualFree(blockIt->VirtualBlock, slice.Allocation);
+}
+
+std::expected<PackedIndices,
+              Error>
+Swift::PackIndices(const BufferPoolHandle poolHandle,
+                   const std::span<const uint32_t> indices)
+{
+    // VMA has no zero sized allocations
+    if (indices.empty())
+    {
+        return std::unexpected(Error::eInvalidArgument);
+    }
+    // 0xFFFF stays free for primitive restart
+    const bool narrow = std::ranges::all_of(indices,
+                                            [](const uint32_t index)
+                                            {
+                                                return index < 0xFFFF;
+                                            });
+    const uint64_t indexSize = narrow ? sizeof(uint16_t) : sizeof(uint32_t);
+    const auto sliceResult =
+        AllocateSlice(poolHandle, indices.size() * indexSize, indexSize);
+    if (!sliceResult)
+    {
+        return std::unexpected(sliceResult.error());
+    }
+    const auto& slice = sliceResult.value();
+
+    if (narrow)
+    {
+        std::ranges::transform(indices,
+                               static_cast<uint16_t*>(slice.Data),
+                               [](const uint32_t index)
+                               {
+                                   return static_cast<uint16_t>(index);
+                               });
+    }
+    else
+    {
+        std::memcpy(slice.Data, indices.data(), indices.size_bytes());
+    }
+
+    return PackedIndices{
+        .Slice = slice,
+        .Type = narrow ? IndexType::eUint16 : IndexType::eUint32,
+        .IndexCount = static_cast<uint32_t>(indices.size()),
+        .FirstIndex = static_cast<uint32_t>(slice.Offset / indexSize),
+    };
+}
+
 std::expected<ImageHandle,
               Error>
 Swift::CreateImage(const ImageCreateInfo& createInfo)
@@ -933,6 +3743,59 @@ void Swift::DestroyImage(const ImageHandle handle)
     Vulkan::DestroyImage(gContext, gImages.at(handle));
 }
 
+std::expected<ImageHandle,
+              Error>
+Swift::CreateImageView(const ImageHandle imageHandle,
+                       const uint32_t baseMip,
+                       const uint32_t mipCount)
+{
+    Image view = gImages.at(imageHandle);
+    view.Allocation = nullptr;
+    view.BaseMip = baseMip;
+    view.MipLevels = mipCount;
+    view.Extent = {std::max(view.Extent.x >> baseMip, 1),
+                   std::max(view.Extent.y >> baseMip, 1)};
+    view.CurrentLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    const ImageCreateInfo viewCreateInfo{
+        .Format = view.Format,
+        .Extent = view.Extent,
+        .Usage = view.Usage,
+        .MipLevels = mipCount,
+        .ArrayLayers = view.ArrayLayers,
+    };
+    const auto viewResult = Vulkan::CreateImageView(gContext.Device,
+                                                    view.BaseImage,
+                                                    viewCreateInfo,
+                                                    baseMip);
+    if (!viewResult)
+    {
+        return std::unexpected(viewResult.error());
+    }
+    view.ImageView = viewResult.value();
+    gImages.emplace_back(view);
+    const uint32_t arrayElement = gImages.size() - 1;
+
+    const auto sampler = view.Sampler == InvalidHandle
+                             ? gSamplers[0]
+                             : gSamplers.at(view.Sampler);
+    Vulkan::UpdateDescriptorSampler(gContext.Device,
+                                    gDescriptor.Set,
+                                    sampler,
+                                    view.ImageView,
+                                    arrayElement,
+                                    VK_IMAGE_LAYOUT_GENERAL);
+    if (view.Usage & VK_IMAGE_USAGE_STORAGE_BIT)
+    {
+        Vulkan::UpdateDescriptorImage(gContext.Device,
+                                      gDescriptor.Set,
+                                      sampler,
+                                      view.ImageView,
+                                      arrayElement);
+    }
+    return arrayElement;
+}
+
 std::expected<TempImageHandle,
               Error>
 Swift::CreateTempImage(const ImageCreateInfo& createInfo)
@@ -950,13 +3813,29 @@ std::expected<SamplerHandle,
               Error>
 Swift::CreateSampler(const SamplerCreateInfo& createInfo)
 {
+    // Identical descriptions share one VkSampler, imports tend to request
+    // the same few samplers thousands of times
+    if (const auto it = gSamplerCache.find(createInfo);
+        it != gSamplerCache.end())
+    {
+        return it->second;
+    }
+
+    const auto& limits = gContext.GPU.properties.limits;
+    if (gSamplers.size() >= limits.maxSamplerAllocationCount)
+    {
+        return std::unexpected(Error::eSamplerCreateFailed);
+    }
+
     const auto samplerResult = Vulkan::CreateSampler(gContext, createInfo);
     if (!samplerResult)
     {
         return std::unexpected(samplerResult.error());
     }
     gSamplers.emplace_back(samplerResult.value());
-    return static_cast<uint32_t>(gSamplers.size() - 1);
+    const auto samplerHandle = static_cast<uint32_t>(gSamplers.size() - 1);
+    gSamplerCache.emplace(createInfo, samplerHandle);
+    return samplerHandle;
 }
 
 VkSampler Swift::GetDefaultSampler() { return gSamplers[0]; }
@@ -1016,6 +3895,31 @@ void Swift::TransitionImage(const ImageHandle imageHandle,
     Vulkan::PipelineBarrier(currentFrameData.Command.Buffer, {transition});
 }
 
+void Swift::TransitionBuffer(const BufferHandle bufferHandle,
+                             const VkPipelineStageFlags2 stage,
+                             const VkAccessFlags2 access)
+{
+    const BufferTransition transition{
+        .Buffer = bufferHandle,
+        .Stage = stage,
+        .Access = access,
+    };
+    TransitionBuffers({&transition, 1});
+}
+
+void Swift::TransitionBuffers(const std::span<const BufferTransition> transitions)
+{
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    for (const auto& transition : transitions)
+    {
+        TrackBufferAccess(barriers,
+                          transition.Buffer,
+                          transition.Stage,
+                          transition.Access);
+    }
+    FlushBufferBarriers(barriers);
+}
+
 void Swift::CopyBufferToImage(const BufferHandle srcBuffer,
                               const ImageHandle dstImageHandle,
                               const std::vector<BufferImageCopy>& copyRegions)
@@ -1027,7 +3931,7 @@ void Swift::CopyBufferToImage(const BufferHandle srcBuffer,
     {
         VkBufferImageCopy2 copy{
             .sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2,
-            .bufferOffset = BufferOffset,
+            .bufferOffset = GetBufferOffset(buffer) + BufferOffset,
             .imageSubresource =
             Vulkan::GetImageSubresourceLayers(VK_IMAGE_ASPECT_COLOR_BIT,
                                               MipLevel,
@@ -1061,4 +3965,9 @@ Command Swift::GetGraphicsCommand()
     return gFrameData.at(gCurrentFrame).Command;
 }
 
-Command Swift::GetTransferCommand() { return gTransferCommand; }
\ No newline at end of file
+Command Swift::GetTransferCommand() { return gTransferCommand; }
+
+void Swift::InvalidateCommandState()
+{
+    gFrameData.at(gCurrentFrame).State = {};
+}
\ No newline at end of file
@@ -10,4 +10,9 @@ namespace Swift::Vulkan::Constants
     constexpr uint8_t StorageBinding = 2;
     constexpr uint16_t MaxImageDescriptors = std::numeric_limits<uint16_t>::max();
     constexpr uint8_t ImageBinding = 3;
+    constexpr uint8_t FramesInFlight = 3;
+    constexpr uint32_t PushConstantSize = 128;
+    // Per query pool, there is one occlusion and one statistics pool per
+    // frame in flight
+    constexpr uint32_t MaxQueries = 1024;
 }
@@ -4,6 +4,7 @@
 #include "VkBootstrap.h"
 #include "VulkanUtil.hpp"
 #include "ranges"
+#include "span"
 
 #ifdef SWIFT_GLFW
 #define GLFW_INCLUDE_VULKAN
@@ -93,30 +94,72 @@ namespace Swift::Vulkan
     CreatePipelineLayout(const Context& context,
                          VkDescriptorSetLayout descriptorSetLayout);
 
+    std::expected<VkQueryPool,
+                  Error>
+    CreateQueryPool(VkDevice device,
+                    VkQueryType queryType,
+                    VkQueryPipelineStatisticFlags statistics = 0);
+
+    std::expected<VkPipelineCache,
+                  Error>
+    CreatePipelineCache(VkDevice device,
+                        std::span<const char> initialData);
+
+    std::vector<char> GetPipelineCacheData(VkDevice device,
+                                           VkPipelineCache pipelineCache);
+
+    // Feedback, when given, receives the driver's creation time and whether
+    // the pipeline cache had the pipeline
     std::expected<VkPipeline,
                   Error>
     CreateGraphicsPipeline(
         VkDevice device,
+        VkPipelineCache pipelineCache,
         VkPipelineLayout pipelineLayout,
         const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages,
-        const GraphicsShaderCreateInfo& createInfo);
+        const GraphicsShaderCreateInfo& createInfo,
+        const DeviceFeatures& features,
+        VkGraphicsPipelineLibraryFlagsEXT libraryFlags = 0,
+        VkPipelineCreationFeedback* feedback = nullptr);
+
+    std::expected<VkPipeline,
+                  Error>
+    LinkGraphicsPipeline(VkDevice device,
+                         VkPipelineCache pipelineCache,
+                         VkPipelineLayout pipelineLayout,
+                         const std::vector<VkPipeline>& libraries,
+                         bool optimize,
+                         VkPipelineCreationFeedback* feedback = nullptr);
 
     std::expected<VkPipeline,
                   Error>
     CreateComputePipeline(VkDevice device,
+                          VkPipelineCache pipelineCache,
                           VkPipelineLayout pipelineLayout,
-                          const VkPipelineShaderStageCreateInfo& shaderStage);
+                          const VkPipelineShaderStageCreateInfo& shaderStage,
+                          VkPipelineCreationFeedback* feedback = nullptr);
+
+    std::expected<std::vector<VkShaderEXT>,
+                  Error>
+    CreateShaderObjects(
+        VkDevice device,
+        VkDescriptorSetLayout descriptorSetLayout,
+        const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages,
+        const std::vector<const std::vector<char>*>& stageCode);
 
     std::expected<VkShaderModule,
                   Error>
     CreateShaderModule(VkDevice device,
                        const std::vector<char>& code);
 
-    std::expected<ShaderInfo,
-                  Error>
-    CreateShader(VkDevice device,
-                 const std::vector<char>& code,
-                 ShaderStage shaderStage);
+    VkPipelineShaderStageCreateInfo
+    GetShaderStage(VkShaderModule shaderModule,
+                   ShaderStage shaderStage,
+                   const char* entryPoint = "main",
+                   const VkSpecializationInfo* specializationInfo = nullptr);
+
+    VkSpecializationInfo
+    GetSpecializationInfo(const SpecializationConstants& constants);
 
     std::expected<VkSampler,
                   Error>
@@ -133,7 +176,8 @@ namespace Swift::Vulkan
                   Error>
     CreateImageView(VkDevice device,
                     VkImage image,
-                    const ImageCreateInfo& createInfo);
+                    const ImageCreateInfo& createInfo,
+                    uint32_t baseMip = 0);
 
     std::expected<Image,
                   Error>
@@ -159,5 +203,9 @@ namespace Swift::Vulkan
     void UnmapBuffer(const Context& context,
                      const Buffer& buffer);
 
+    std::expected<VmaVirtualBlock,
+                  Error>
+    CreateVirtualBlock(uint64_t size);
+
 #include "VulkanInit.inl"
 } // namespace Swift::Vulkan
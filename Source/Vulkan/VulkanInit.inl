@@ -192,10 +192,97 @@ CreateContext(const InitInfo& info)
     {
         return std::unexpected(Error::eNoDeviceFound);
     }
-    const vkb::PhysicalDevice& gpu = gpuSelector.value();
+    vkb::PhysicalDevice gpu = gpuSelector.value();
+
+    // Optional extensions are enabled when present and reported through
+    // context.Features
+    VkPhysicalDeviceVulkan12Features minmaxFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .samplerFilterMinmax = true,
+    };
+    context.Features.SamplerFilterMinmax =
+        gpu.enable_extension_features_if_present(minmaxFeatures);
+    VkPhysicalDeviceMultiDrawFeaturesEXT multiDrawFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTI_DRAW_FEATURES_EXT,
+        .multiDraw = true,
+    };
+    context.Features.MultiDraw =
+        gpu.enable_extension_if_present(VK_EXT_MULTI_DRAW_EXTENSION_NAME) &&
+        gpu.enable_extension_features_if_present(multiDrawFeatures);
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+        .taskShader = true,
+        .meshShader = true,
+    };
+    context.Features.MeshShader =
+        gpu.enable_extension_if_present(VK_EXT_MESH_SHADER_EXTENSION_NAME) &&
+        gpu.enable_extension_features_if_present(meshShaderFeatures);
+    context.Features.DepthClamp =
+        gpu.enable_features_if_present(VkPhysicalDeviceFeatures{
+            .depthClamp = true,
+        });
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamicState3Features{
+        .sType =
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+        .extendedDynamicState3DepthClampEnable = context.Features.DepthClamp,
+        .extendedDynamicState3PolygonMode = true,
+        .extendedDynamicState3RasterizationSamples = true,
+        .extendedDynamicState3ColorBlendEnable = true,
+        .extendedDynamicState3ColorBlendEquation = true,
+        .extendedDynamicState3ColorWriteMask = true,
+    };
+    context.Features.ExtendedDynamicState3 =
+        gpu.enable_extension_if_present(
+            VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME) &&
+        gpu.enable_extension_features_if_present(dynamicState3Features);
+    VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT,
+        .shaderObject = true,
+    };
+    context.Features.ShaderObject =
+        info.UseShaderObjects &&
+        gpu.enable_extension_if_present(VK_EXT_SHADER_OBJECT_EXTENSION_NAME) &&
+        gpu.enable_extension_features_if_present(shaderObjectFeatures);
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{
+        .sType =
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+        .graphicsPipelineLibrary = true,
+    };
+    context.Features.GraphicsPipelineLibrary =
+        !context.Features.ShaderObject &&
+        gpu.enable_extension_if_present(
+            VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+        gpu.enable_extension_if_present(
+            VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+        gpu.enable_extension_features_if_present(pipelineLibraryFeatures);
+    context.Features.SamplerAnisotropy =
+        gpu.enable_features_if_present(VkPhysicalDeviceFeatures{
+            .samplerAnisotropy = true,
+        });
+    context.Features.DrawIndirectFirstInstance =
+        gpu.enable_features_if_present(VkPhysicalDeviceFeatures{
+            .drawIndirectFirstInstance = true,
+        });
+    context.Features.PreciseOcclusion =
+        gpu.enable_features_if_present(VkPhysicalDeviceFeatures{
+            .occlusionQueryPrecise = true,
+        });
+    context.Features.PipelineStatistics =
+        gpu.enable_features_if_present(VkPhysicalDeviceFeatures{
+            .pipelineStatisticsQuery = true,
+        });
+    VkPhysicalDeviceConditionalRenderingFeaturesEXT conditionalRenderingFeatures{
+        .sType =
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT,
+        .conditionalRendering = true,
+    };
+    context.Features.ConditionalRendering =
+        gpu.enable_extension_if_present(
+            VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME) &&
+        gpu.enable_extension_features_if_present(conditionalRenderingFeatures);
     context.GPU = gpu;
 
-    const auto deviceResult = vkb::DeviceBuilder(gpuSelector.value()).build();
+    const auto deviceResult = vkb::DeviceBuilder(gpu).build();
     if (!deviceResult.has_value())
     {
         std::cout << deviceResult.error().message() << std::endl;
@@ -221,6 +308,37 @@ CreateContext(const InitInfo& info)
     };
     vmaCreateAllocator(&allocatorInfo, &context.Allocator);
 
+    // The feature only guarantees min/max filtering for some formats, check
+    // the one depth pyramids are reduced in
+    VkFormatProperties minmaxFormatProperties{};
+    vkGetPhysicalDeviceFormatProperties(context.GPU,
+                                        VK_FORMAT_R32_SFLOAT,
+                                        &minmaxFormatProperties);
+    context.Features.SamplerFilterMinmax =
+        context.Features.SamplerFilterMinmax &&
+        (minmaxFormatProperties.optimalTilingFeatures &
+         VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_MINMAX_BIT);
+
+    VkPhysicalDeviceMultiDrawPropertiesEXT multiDrawProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTI_DRAW_PROPERTIES_EXT,
+    };
+    VkPhysicalDeviceSubgroupProperties subgroupProperties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES,
+        .pNext = context.Features.MultiDraw ? &multiDrawProperties : nullptr,
+    };
+    VkPhysicalDeviceProperties2 properties{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &subgroupProperties,
+    };
+    vkGetPhysicalDeviceProperties2(context.GPU, &properties);
+    constexpr VkSubgroupFeatureFlags arithmeticOperations =
+        VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+    context.Features.SubgroupArithmetic =
+        (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+        (subgroupProperties.supportedOperations & arithmeticOperations) ==
+            arithmeticOperations;
+    context.Features.MaxMultiDrawCount = multiDrawProperties.maxMultiDrawCount;
+
     return context;
 }
 
@@ -609,7 +727,7 @@ CreatePipelineLayout(const Context& context,
     constexpr VkPushConstantRange pushConstants{
         .stageFlags = VK_SHADER_STAGE_ALL,
         .offset = 0,
-        .size = 128,
+        .size = Constants::PushConstantSize,
     };
     const VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
@@ -628,20 +746,94 @@ CreatePipelineLayout(const Context& context,
                        Error::ePipelineLayoutCreateFailed);
 }
 
+inline std::expected<VkQueryPool,
+                     Error>
+CreateQueryPool(const VkDevice device,
+                const VkQueryType queryType,
+                const VkQueryPipelineStatisticFlags statistics)
+{
+    const VkQueryPoolCreateInfo queryPoolCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = queryType,
+        .queryCount = Constants::MaxQueries,
+        .pipelineStatistics = statistics,
+    };
+    VkQueryPool queryPool;
+    const auto result = vkCreateQueryPool(device,
+                                          &queryPoolCreateInfo,
+                                          nullptr,
+                                          &queryPool);
+    return CheckResult(result, queryPool, Error::eQueryCreateFailed);
+}
+
+// The driver ignores data from another device or driver version
+inline std::expected<VkPipelineCache,
+                     Error>
+CreatePipelineCache(const VkDevice device,
+                    const std::span<const char> initialData)
+{
+    const VkPipelineCacheCreateInfo pipelineCacheCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = initialData.size(),
+        .pInitialData = initialData.data(),
+    };
+    VkPipelineCache pipelineCache;
+    const auto result = vkCreatePipelineCache(device,
+                                              &pipelineCacheCreateInfo,
+                                              nullptr,
+                                              &pipelineCache);
+    return CheckResult(result, pipelineCache, Error::ePipelineCreateFailed);
+}
+
+inline std::vector<char> GetPipelineCacheData(const VkDevice device,
+                                              const VkPipelineCache pipelineCache)
+{
+    size_t size = 0;
+    vkGetPipelineCacheData(device, pipelineCache, &size, nullptr);
+    std::vector<char> data(size);
+    vkGetPipelineCacheData(device, pipelineCache, &size, data.data());
+    data.resize(size);
+    return data;
+}
+
+inline VkPipelineCreationFeedbackCreateInfo
+GetCreationFeedbackInfo(VkPipelineCreationFeedback* feedback,
+                        const void* next)
+{
+    return VkPipelineCreationFeedbackCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+        .pNext = next,
+        .pPipelineCreationFeedback = feedback,
+    };
+}
+
 inline std::expected<VkPipeline,
                      Error>
 CreateGraphicsPipeline(
     const VkDevice device,
+    const VkPipelineCache pipelineCache,
     const VkPipelineLayout pipelineLayout,
     const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages,
-    const GraphicsShaderCreateInfo& createInfo)
+    const GraphicsShaderCreateInfo& createInfo,
+    const DeviceFeatures& features,
+    const VkGraphicsPipelineLibraryFlagsEXT libraryFlags,
+    VkPipelineCreationFeedback* feedback)
 {
+    // Libraries ignore the state outside their part
+    const VkGraphicsPipelineLibraryCreateInfoEXT libraryCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+        .flags = libraryFlags,
+    };
     VkPipelineRenderingCreateInfo renderCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+        .pNext = libraryFlags ? &libraryCreateInfo : nullptr,
         .colorAttachmentCount =
             static_cast<uint32_t>(createInfo.ColorFormats.size()),
         .pColorAttachmentFormats = createInfo.ColorFormats.data(),
         .depthAttachmentFormat = createInfo.DepthFormat,
+        .stencilAttachmentFormat = HasStencil(createInfo.DepthFormat)
+                                       ? createInfo.DepthFormat
+                                       : VK_FORMAT_UNDEFINED,
     };
     constexpr auto vertexInputCreateInfo = VkPipelineVertexInputStateCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
@@ -660,52 +852,88 @@ CreateGraphicsPipeline(
     };
     const auto rasterizerCreateInfo = VkPipelineRasterizationStateCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable =
+            features.DepthClamp && createInfo.Raster.DepthClampEnable,
         .polygonMode = createInfo.PolygonMode,
         .cullMode = VK_CULL_MODE_BACK_BIT,
         .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .depthBiasEnable = createInfo.Raster.DepthBiasEnable,
+        .depthBiasConstantFactor = createInfo.Raster.DepthBiasConstantFactor,
+        .depthBiasClamp = createInfo.Raster.DepthBiasClamp,
+        .depthBiasSlopeFactor = createInfo.Raster.DepthBiasSlopeFactor,
         .lineWidth = 1.f,
     };
     const auto multisampleCreateInfo = VkPipelineMultisampleStateCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
         .rasterizationSamples = createInfo.Samples,
     };
-    constexpr auto depthStencilCreateInfo =
-        VkPipelineDepthStencilStateCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-            .depthTestEnable = true,
-            .depthWriteEnable = true,
-            .depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
-        };
-    constexpr auto colorBlendAttachmentState =
-        VkPipelineColorBlendAttachmentState{
-            .blendEnable = true,
-            .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
-            .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-            .colorBlendOp = VK_BLEND_OP_ADD,
-            .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
-            .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-            .alphaBlendOp = VK_BLEND_OP_ADD,
-            .colorWriteMask =
-                VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-                VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-        };
-    std::vector colorBlendAttachments{createInfo.ColorFormats.size(),
-                                      colorBlendAttachmentState};
+    // Depth test, write and compare op are dynamic, so only stencil matters
+    const auto& depthStencil = createInfo.DepthStencil;
+    const auto depthStencilCreateInfo = VkPipelineDepthStencilStateCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = true,
+        .depthWriteEnable = true,
+        .depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+        .stencilTestEnable = depthStencil.StencilTest,
+        .front = depthStencil.StencilFront,
+        .back = depthStencil.StencilBack,
+    };
+    std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments;
+    for (size_t i = 0; i < createInfo.ColorFormats.size(); ++i)
+    {
+        const auto blend = i < createInfo.BlendStates.size()
+                               ? createInfo.BlendStates[i]
+                               : BlendState{};
+        colorBlendAttachments.emplace_back(VkPipelineColorBlendAttachmentState{
+            .blendEnable = blend.BlendEnable,
+            .srcColorBlendFactor = blend.SrcColorFactor,
+            .dstColorBlendFactor = blend.DstColorFactor,
+            .colorBlendOp = blend.ColorOp,
+            .srcAlphaBlendFactor = blend.SrcAlphaFactor,
+            .dstAlphaBlendFactor = blend.DstAlphaFactor,
+            .alphaBlendOp = blend.AlphaOp,
+            .colorWriteMask = blend.WriteMask,
+        });
+    }
     const auto colorBlendStateCreateInfo = VkPipelineColorBlendStateCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
         .attachmentCount = static_cast<uint32_t>(colorBlendAttachments.size()),
         .pAttachments = colorBlendAttachments.data(),
     };
 
-    constexpr std::array dynamicStates{VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT,
-                                       VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT,
-                                       VK_DYNAMIC_STATE_LINE_WIDTH,
-                                       VK_DYNAMIC_STATE_CULL_MODE,
-                                       VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
-                                       VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
-                                       VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
-                                       VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY,
-                                       VK_DYNAMIC_STATE_FRONT_FACE};
+    std::vector dynamicStates{VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT,
+                              VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT,
+                              VK_DYNAMIC_STATE_LINE_WIDTH,
+                              VK_DYNAMIC_STATE_CULL_MODE,
+                              VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+                              VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+                              VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
+                              VK_DYNAMIC_STATE_FRONT_FACE};
+    // Mesh pipelines have no input assembly, so no topology to set
+    const bool meshPipeline =
+        std::ranges::any_of(shaderStages,
+                            [](const VkPipelineShaderStageCreateInfo& stage)
+                            {
+                                return stage.stage ==
+                                       VK_SHADER_STAGE_MESH_BIT_EXT;
+                            });
+    if (!meshPipeline)
+    {
+        dynamicStates.emplace_back(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY);
+    }
+    if (features.ExtendedDynamicState3)
+    {
+        dynamicStates.insert(dynamicStates.end(),
+                             {VK_DYNAMIC_STATE_POLYGON_MODE_EXT,
+                              VK_DYNAMIC_STATE_RASTERIZATION_SAMPLES_EXT,
+                              VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT,
+                              VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT,
+                              VK_DYNAMIC_STATE_COLOR_WRITE_MASK_EXT});
+        if (features.DepthClamp)
+        {
+            dynamicStates.emplace_back(VK_DYNAMIC_STATE_DEPTH_CLAMP_ENABLE_EXT);
+        }
+    }
 
     const auto dynamicStateCreateInfo = VkPipelineDynamicStateCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
@@ -713,14 +941,23 @@ CreateGraphicsPipeline(
         .pDynamicStates = dynamicStates.data(),
     };
 
+    const auto feedbackCreateInfo =
+        GetCreationFeedbackInfo(feedback, &renderCreateInfo);
+
     VkPipeline pipeline;
     VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo{
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .pNext = &renderCreateInfo,
+        .pNext = feedback ? static_cast<const void*>(&feedbackCreateInfo)
+                          : &renderCreateInfo,
+        .flags = libraryFlags
+                     ? VK_PIPELINE_CREATE_LIBRARY_BIT_KHR |
+                           VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT
+                     : VkPipelineCreateFlags{},
         .stageCount = static_cast<uint32_t>(shaderStages.size()),
         .pStages = shaderStages.data(),
-        .pVertexInputState = &vertexInputCreateInfo,
-        .pInputAssemblyState = &inputAssemblyCreateInfo,
+        .pVertexInputState = meshPipeline ? nullptr : &vertexInputCreateInfo,
+        .pInputAssemblyState =
+            meshPipeline ? nullptr : &inputAssemblyCreateInfo,
         .pViewportState = &viewportCreateInfo,
         .pRasterizationState = &rasterizerCreateInfo,
         .pMultisampleState = &multisampleCreateInfo,
@@ -730,7 +967,7 @@ CreateGraphicsPipeline(
         .layout = pipelineLayout,
     };
     const auto result = vkCreateGraphicsPipelines(device,
-                                                  nullptr,
+                                                  pipelineCache,
                                                   1,
                                                   &graphicsPipelineCreateInfo,
                                                   nullptr,
@@ -739,20 +976,60 @@ CreateGraphicsPipeline(
     return CheckResult(result, pipeline, Error::ePipelineCreateFailed);
 }
 
+// Without optimization this is the fast link, with it the driver compiles
+// across the parts like for a monolithic pipeline
+inline std::expected<VkPipeline,
+                     Error>
+LinkGraphicsPipeline(const VkDevice device,
+                     const VkPipelineCache pipelineCache,
+                     const VkPipelineLayout pipelineLayout,
+                     const std::vector<VkPipeline>& libraries,
+                     const bool optimize,
+                     VkPipelineCreationFeedback* feedback)
+{
+    const VkPipelineLibraryCreateInfoKHR libraryCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+        .libraryCount = static_cast<uint32_t>(libraries.size()),
+        .pLibraries = libraries.data(),
+    };
+    const auto feedbackCreateInfo =
+        GetCreationFeedbackInfo(feedback, &libraryCreateInfo);
+    const VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = feedback ? static_cast<const void*>(&feedbackCreateInfo)
+                          : &libraryCreateInfo,
+        .flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT
+                          : VkPipelineCreateFlags{},
+        .layout = pipelineLayout,
+    };
+    VkPipeline pipeline;
+    const auto result = vkCreateGraphicsPipelines(device,
+                                                  pipelineCache,
+                                                  1,
+                                                  &graphicsPipelineCreateInfo,
+                                                  nullptr,
+                                                  &pipeline);
+    return CheckResult(result, pipeline, Error::ePipelineCreateFailed);
+}
+
 inline std::expected<VkPipeline,
                      Error>
 CreateComputePipeline(const VkDevice device,
+                      const VkPipelineCache pipelineCache,
                       const VkPipelineLayout pipelineLayout,
-                      const VkPipelineShaderStageCreateInfo& shaderStage)
+                      const VkPipelineShaderStageCreateInfo& shaderStage,
+                      VkPipelineCreationFeedback* feedback)
 {
+    const auto feedbackCreateInfo = GetCreationFeedbackInfo(feedback, nullptr);
     const VkComputePipelineCreateInfo computePipelineCreateInfo{
         .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = feedback ? &feedbackCreateInfo : nullptr,
         .stage = shaderStage,
         .layout = pipelineLayout,
     };
     VkPipeline pipeline;
     const auto result = vkCreateComputePipelines(device,
-                                                 nullptr,
+                                                 pipelineCache,
                                                  1,
                                                  &computePipelineCreateInfo,
                                                  nullptr,
@@ -760,6 +1037,68 @@ CreateComputePipeline(const VkDevice device,
     return CheckResult(result, pipeline, Error::ePipelineCreateFailed);
 }
 
+// Creates the stages linked together, so drivers can still optimize across
+// them like they would for a pipeline
+inline std::expected<std::vector<VkShaderEXT>,
+                     Error>
+CreateShaderObjects(
+    const VkDevice device,
+    const VkDescriptorSetLayout descriptorSetLayout,
+    const std::vector<VkPipelineShaderStageCreateInfo>& shaderStages,
+    const std::vector<const std::vector<char>*>& stageCode)
+{
+    constexpr VkPushConstantRange pushConstants{
+        .stageFlags = VK_SHADER_STAGE_ALL,
+        .offset = 0,
+        .size = Constants::PushConstantSize,
+    };
+    const bool taskShader =
+        std::ranges::any_of(shaderStages,
+                            [](const VkPipelineShaderStageCreateInfo& stage)
+                            {
+                                return stage.stage ==
+                                       VK_SHADER_STAGE_TASK_BIT_EXT;
+                            });
+
+    std::vector<VkShaderCreateInfoEXT> createInfos;
+    for (size_t i = 0; i < shaderStages.size(); ++i)
+    {
+        const auto& stage = shaderStages[i];
+        VkShaderCreateFlagsEXT flags = VK_SHADER_CREATE_LINK_STAGE_BIT_EXT;
+        if (stage.stage == VK_SHADER_STAGE_MESH_BIT_EXT && !taskShader)
+        {
+            flags |= VK_SHADER_CREATE_NO_TASK_SHADER_BIT_EXT;
+        }
+        createInfos.emplace_back(VkShaderCreateInfoEXT{
+            .sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+            .flags = flags,
+            .stage = stage.stage,
+            .nextStage = i + 1 < shaderStages.size()
+                             ? static_cast<VkShaderStageFlags>(
+                                   shaderStages[i + 1].stage)
+                             : 0,
+            .codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+            .codeSize = stageCode[i]->size(),
+            .pCode = stageCode[i]->data(),
+            .pName = stage.pName,
+            .setLayoutCount = 1,
+            .pSetLayouts = &descriptorSetLayout,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushConstants,
+            .pSpecializationInfo = stage.pSpecializationInfo,
+        });
+    }
+
+    std::vector<VkShaderEXT> shaders(createInfos.size());
+    const auto result =
+        vkCreateShadersEXT(device,
+                           static_cast<uint32_t>(createInfos.size()),
+                           createInfos.data(),
+                           nullptr,
+                           shaders.data());
+    return CheckResult(result, shaders, Error::eShaderCreateFailed);
+}
+
 inline std::expected<VkShaderModule,
                      Error>
 CreateShaderModule(const VkDevice device,
@@ -776,11 +1115,11 @@ CreateShaderModule(const VkDevice device,
     return CheckResult(result, shaderModule, Error::eShaderCreateFailed);
 }
 
-inline std::expected<ShaderInfo,
-                     Error>
-CreateShader(const VkDevice device,
-             const std::vector<char>& code,
-             const ShaderStage shaderStage)
+inline VkPipelineShaderStageCreateInfo
+GetShaderStage(const VkShaderModule shaderModule,
+               const ShaderStage shaderStage,
+               const char* entryPoint,
+               const VkSpecializationInfo* specializationInfo)
 {
     VkShaderStageFlagBits stageFlags = {};
     switch (shaderStage)
@@ -797,24 +1136,32 @@ CreateShader(const VkDevice device,
     case ShaderStage::eCompute:
         stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
         break;
+    case ShaderStage::eTask:
+        stageFlags = VK_SHADER_STAGE_TASK_BIT_EXT;
+        break;
+    case ShaderStage::eMesh:
+        stageFlags = VK_SHADER_STAGE_MESH_BIT_EXT;
+        break;
     }
-    auto shaderResult = Vulkan::CreateShaderModule(device, code);
-    if (!shaderResult)
-    {
-        return std::unexpected(shaderResult.error());
-    }
-    const VkPipelineShaderStageCreateInfo shaderStageInfo = {
+    return VkPipelineShaderStageCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
         .stage = stageFlags,
-        .module = shaderResult.value(),
-        .pName = "main",
+        .module = shaderModule,
+        .pName = entryPoint,
+        .pSpecializationInfo = specializationInfo,
     };
+}
 
-    ShaderInfo shader{
-        .ShaderModule = shaderResult.value(),
-        .ShaderStage = shaderStageInfo,
+// Points into the constants, which have to outlive pipeline creation
+inline VkSpecializationInfo
+GetSpecializationInfo(const SpecializationConstants& constants)
+{
+    return VkSpecializationInfo{
+        .mapEntryCount = static_cast<uint32_t>(constants.Entries.size()),
+        .pMapEntries = constants.Entries.data(),
+        .dataSize = constants.Data.size(),
+        .pData = constants.Data.data(),
     };
-    return shader;
 }
 
 inline std::expected<VkSampler,
@@ -822,28 +1169,43 @@ inline std::expected<VkSampler,
 CreateSampler(const Context& context,
               const SamplerCreateInfo& createInfo)
 {
-    {
-        VkPhysicalDeviceProperties properties;
-        vkGetPhysicalDeviceProperties(context.GPU, &properties);
-        const VkSamplerCreateInfo samplerInfo{
-            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-            .magFilter = createInfo.MagFilter,
-            .minFilter = createInfo.MinFilter,
-            .mipmapMode = createInfo.MipmapMode,
-            .addressModeU = createInfo.AddressModeU,
-            .addressModeV = createInfo.AddressModeV,
-            .addressModeW = createInfo.AddressModeW,
-            .minLod = 0,
-            .maxLod = 16,
-            .borderColor = createInfo.BorderColor,
-            .unnormalizedCoordinates = false,
-
-        };
-        VkSampler sampler;
-        const auto result =
-            vkCreateSampler(context.Device, &samplerInfo, nullptr, &sampler);
-        return CheckResult(result, sampler, Error::eSamplerCreateFailed);
-    }
+    // The limits were queried once during device selection
+    const auto& limits = context.GPU.properties.limits;
+    const VkSamplerReductionModeCreateInfo reductionInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO,
+        .reductionMode = createInfo.ReductionMode,
+    };
+    const bool weighted =
+        createInfo.ReductionMode == VK_SAMPLER_REDUCTION_MODE_WEIGHTED_AVERAGE;
+    const VkSamplerCreateInfo samplerInfo{
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = weighted ? nullptr : &reductionInfo,
+        .magFilter = createInfo.MagFilter,
+        .minFilter = createInfo.MinFilter,
+        .mipmapMode = createInfo.MipmapMode,
+        .addressModeU = createInfo.AddressModeU,
+        .addressModeV = createInfo.AddressModeV,
+        .addressModeW = createInfo.AddressModeW,
+        .mipLodBias = std::clamp(createInfo.MipLodBias,
+                                 -limits.maxSamplerLodBias,
+                                 limits.maxSamplerLodBias),
+        // Without the feature the sampler falls back to plain filtering
+        .anisotropyEnable = context.Features.SamplerAnisotropy &&
+                            createInfo.AnisotropyEnable,
+        .maxAnisotropy = std::clamp(createInfo.MaxAnisotropy,
+                                    1.f,
+                                    limits.maxSamplerAnisotropy),
+        .compareEnable = createInfo.CompareEnable,
+        .compareOp = createInfo.CompareOp,
+        .minLod = createInfo.MinLod,
+        .maxLod = createInfo.MaxLod,
+        .borderColor = createInfo.BorderColor,
+        .unnormalizedCoordinates = false,
+    };
+    VkSampler sampler;
+    const auto result =
+        vkCreateSampler(context.Device, &samplerInfo, nullptr, &sampler);
+    return CheckResult(result, sampler, Error::eSamplerCreateFailed);
 }
 
 inline std::expected<std::tuple<VkImage,
@@ -889,13 +1251,17 @@ inline std::expected<VkImageView,
                      Error>
 CreateImageView(const VkDevice device,
                 const VkImage image,
-                const ImageCreateInfo& createInfo)
+                const ImageCreateInfo& createInfo,
+                const uint32_t baseMip)
 {
     VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     const auto layers = createInfo.ArrayLayers;
 
+    // Sampled views of a depth stencil image can only have one aspect, as an
+    // attachment the view's aspect is ignored and both are used
     if (createInfo.Format == VK_FORMAT_D16_UNORM ||
-        createInfo.Format == VK_FORMAT_D32_SFLOAT)
+        createInfo.Format == VK_FORMAT_D32_SFLOAT ||
+        HasStencil(createInfo.Format))
     {
         aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
     }
@@ -907,7 +1273,7 @@ CreateImageView(const VkDevice device,
             layers == 6 ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D,
         .format = createInfo.Format,
         .subresourceRange = GetImageSubresourceRange(aspectMask,
-                                                     0,
+                                                     baseMip,
                                                      createInfo.MipLevels,
                                                      0,
                                                      layers),
@@ -942,13 +1308,18 @@ CreateImage(const Context& context,
     image.Sampler = createInfo.Sampler;
     image.MipLevels = createInfo.MipLevels;
     image.ArrayLayers = createInfo.ArrayLayers;
+    image.Format = createInfo.Format;
+    image.Usage = createInfo.Usage;
     return image;
 }
 
 inline void DestroyImage(const Swift::Context& context,
                          Image& image)
 {
-    vmaDestroyImage(context.Allocator, image.BaseImage, image.Allocation);
+    if (image.Allocation)
+    {
+        vmaDestroyImage(context.Allocator, image.BaseImage, image.Allocation);
+    }
     vkDestroyImageView(context.Device, image.ImageView, nullptr);
     image.BaseImage = nullptr;
     image.ImageView = nullptr;
@@ -977,12 +1348,45 @@ CreateBuffer(const Swift::Context& context,
     case BufferUsage::eIndirect:
         usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
         break;
+    case BufferUsage::eGeometry:
+        usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                 VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                 VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        break;
+    case BufferUsage::ePredicate:
+        usage |= VK_BUFFER_USAGE_CONDITIONAL_RENDERING_BIT_EXT;
+        break;
+    case BufferUsage::eTransient:
+        usage |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                 VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                 VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        break;
     default:
         break;
     }
+    Buffer buffer;
+    buffer.Size = createInfo.Size;
+    buffer.Dynamic = createInfo.Dynamic;
+    buffer.VersionStride = createInfo.Size;
+    if (createInfo.Dynamic)
+    {
+        const auto& limits = context.GPU.properties.limits;
+        const uint64_t alignment =
+            std::max({limits.minUniformBufferOffsetAlignment,
+                      limits.minStorageBufferOffsetAlignment,
+                      VkDeviceSize{16}});
+        buffer.VersionStride =
+            (createInfo.Size + alignment - 1) / alignment * alignment;
+    }
+    const uint64_t versionCount =
+        createInfo.Dynamic ? Constants::FramesInFlight : 1;
+
     const VkBufferCreateInfo bufferCreateInfo{
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .size = createInfo.Size,
+        .size = buffer.VersionStride * versionCount,
         .usage = usage,
         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
     };
@@ -994,14 +1398,18 @@ CreateBuffer(const Swift::Context& context,
                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
     };
-    Buffer buffer;
     const auto result = vmaCreateBuffer(context.Allocator,
                                         &bufferCreateInfo,
                                         &allocCreateInfo,
                                         &buffer.BaseBuffer,
                                         &buffer.Allocation,
                                         &buffer.AllocationInfo);
-    return CheckResult(result, buffer, Error::eBufferCreateFailed);
+    if (result != VK_SUCCESS)
+    {
+        return std::unexpected(Error::eBufferCreateFailed);
+    }
+    buffer.Address = GetBufferAddress(context.Device, buffer.BaseBuffer);
+    return buffer;
 }
 
 inline std::expected<void*,
@@ -1021,6 +1429,18 @@ inline void UnmapBuffer(const Swift::Context& context,
     vmaUnmapMemory(context.Allocator, buffer.Allocation);
 }
 
+inline std::expected<VmaVirtualBlock,
+                     Error>
+CreateVirtualBlock(const uint64_t size)
+{
+    const VmaVirtualBlockCreateInfo blockCreateInfo{
+        .size = size,
+    };
+    VmaVirtualBlock block;
+    const auto result = vmaCreateVirtualBlock(&blockCreateInfo, &block);
+    return CheckResult(result, block, Error::eBufferCreateFailed);
+}
+
 inline void DestroyBuffer(const VmaAllocator& allocator,
                           Buffer& buffer)
 {
@@ -0,0 +1,17 @@
+#pragma once
+#include "SwiftInternal.hpp"
+#include "VulkanUtil.hpp"
+#include "span"
+
+namespace Swift::Vulkan
+{
+    // Reads one entry point of a SPIR-V module and merges what it declares
+    // into the reflection. Fails on malformed code or a missing entry point
+    std::expected<void,
+                  Error>
+    ReflectShader(const std::vector<char>& code,
+                  const ShaderSpecialization& specialization,
+                  ShaderReflection& reflection);
+
+#include "VulkanReflect.inl"
+} // namespace Swift::Vulkan
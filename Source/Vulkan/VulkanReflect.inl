@@ -0,0 +1,406 @@
+#pragma once
+#include "SwiftEnums.hpp"
+
+namespace SpirV
+{
+    constexpr uint32_t Magic = 0x07230203;
+    constexpr uint32_t HeaderWords = 5;
+
+    enum Op : uint32_t
+    {
+        eOpEntryPoint = 15,
+        eOpExecutionMode = 16,
+        eOpTypeBool = 20,
+        eOpTypeInt = 21,
+        eOpTypeFloat = 22,
+        eOpTypeVector = 23,
+        eOpTypeMatrix = 24,
+        eOpTypeArray = 28,
+        eOpTypeRuntimeArray = 29,
+        eOpTypeStruct = 30,
+        eOpTypePointer = 32,
+        eOpConstant = 43,
+        eOpConstantComposite = 44,
+        eOpSpecConstant = 50,
+        eOpSpecConstantComposite = 51,
+        eOpVariable = 59,
+        eOpDecorate = 71,
+        eOpMemberDecorate = 72,
+        eOpExecutionModeId = 331,
+    };
+
+    enum Decoration : uint32_t
+    {
+        eSpecId = 1,
+        eArrayStride = 6,
+        eMatrixStride = 7,
+        eBuiltIn = 11,
+        eBinding = 33,
+        eDescriptorSet = 34,
+        eOffset = 35,
+    };
+
+    constexpr uint32_t ExecutionModeLocalSize = 17;
+    constexpr uint32_t ExecutionModeLocalSizeId = 38;
+    constexpr uint32_t BuiltInWorkgroupSize = 25;
+    constexpr uint32_t StorageClassPushConstant = 9;
+    constexpr uint32_t StorageClassPhysicalStorageBuffer = 5349;
+    constexpr uint32_t None = ~0u;
+
+    struct Member
+    {
+        uint32_t Offset{};
+        uint32_t MatrixStride{};
+    };
+
+    struct Module
+    {
+        std::vector<uint32_t> Words;
+        // Word index of the instruction defining each id
+        std::vector<uint32_t> Definitions;
+        std::vector<uint32_t> SpecIds;
+        std::vector<uint32_t> ArrayStrides;
+        std::vector<uint32_t> Bindings;
+        std::vector<uint32_t> DescriptorSets;
+        std::vector<std::vector<Member>> Members;
+        uint32_t WorkgroupSize = None;
+
+        uint32_t Opcode(const uint32_t id) const
+        {
+            return Words[Definitions[id]] & 0xFFFF;
+        }
+
+        uint32_t Operand(const uint32_t id,
+                         const uint32_t index) const
+        {
+            return Words[Definitions[id] + 1 + index];
+        }
+    };
+
+    inline std::optional<ShaderStage> GetStage(const uint32_t model)
+    {
+        switch (model)
+        {
+        case 0:
+            return ShaderStage::eVertex;
+        case 3:
+            return ShaderStage::eGeometry;
+        case 4:
+            return ShaderStage::eFragment;
+        case 5:
+            return ShaderStage::eCompute;
+        case 5364:
+            return ShaderStage::eTask;
+        case 5365:
+            return ShaderStage::eMesh;
+        default:
+            return std::nullopt;
+        }
+    }
+
+    // Specialized values are read from the constants the pipeline is
+    // created with, so this matches what the driver compiles
+    inline uint32_t GetConstant(const Module& module,
+                                const uint32_t id,
+                                const SpecializationConstants& constants)
+    {
+        const uint32_t opcode = module.Opcode(id);
+        if (opcode == eOpSpecConstant && module.SpecIds[id] != None)
+        {
+            const auto entry =
+                std::ranges::find(constants.Entries,
+                                  module.SpecIds[id],
+                                  &VkSpecializationMapEntry::constantID);
+            if (entry != constants.Entries.end() && entry->size >= 4)
+            {
+                uint32_t value;
+                std::memcpy(&value,
+                            constants.Data.data() + entry->offset,
+                            sizeof(value));
+                return value;
+            }
+        }
+        if (opcode == eOpConstant || opcode == eOpSpecConstant)
+        {
+            return module.Operand(id, 2);
+        }
+        return 0;
+    }
+
+    // Arrays sized by specialization constants take their specialized length
+    inline uint32_t GetTypeSize(const Module& module,
+                                const uint32_t id,
+                                const SpecializationConstants& constants,
+                                const uint32_t matrixStride = 0)
+    {
+        switch (module.Opcode(id))
+        {
+        case eOpTypeBool:
+            return 4;
+        case eOpTypeInt:
+        case eOpTypeFloat:
+            return module.Operand(id, 1) / 8;
+        case eOpTypeVector:
+            return module.Operand(id, 2) *
+                   GetTypeSize(module, module.Operand(id, 1), constants);
+        case eOpTypeMatrix:
+        {
+            const uint32_t columns = module.Operand(id, 2);
+            const uint32_t stride =
+                matrixStride ? matrixStride
+                             : GetTypeSize(module,
+                                           module.Operand(id, 1),
+                                           constants);
+            return columns * stride;
+        }
+        case eOpTypeArray:
+        {
+            const uint32_t element = module.Operand(id, 1);
+            const uint32_t length =
+                GetConstant(module, module.Operand(id, 2), constants);
+            const uint32_t stride = module.ArrayStrides[id] != None
+                                        ? module.ArrayStrides[id]
+                                        : GetTypeSize(module,
+                                                      element,
+                                                      constants);
+            return length * stride;
+        }
+        case eOpTypeStruct:
+        {
+            const uint32_t memberCount =
+                (module.Words[module.Definitions[id]] >> 16) - 2;
+            const auto& members = module.Members[id];
+            uint32_t size = 0;
+            for (uint32_t i = 0; i < memberCount && i < members.size(); ++i)
+            {
+                size = std::max(size,
+                                members[i].Offset +
+                                    GetTypeSize(module,
+                                                module.Operand(id, 1 + i),
+                                                constants,
+                                                members[i].MatrixStride));
+            }
+            return size;
+        }
+        case eOpTypePointer:
+            // Buffer references are 64 bit addresses
+            return module.Operand(id, 1) == StorageClassPhysicalStorageBuffer
+                       ? 8
+                       : 0;
+        default:
+            return 0;
+        }
+    }
+} // namespace SpirV
+
+inline std::expected<void,
+                     Error>
+ReflectShader(const std::vector<char>& code,
+              const ShaderSpecialization& specialization,
+              ShaderReflection& reflection)
+{
+    using namespace SpirV;
+    if (code.size() % 4 != 0 || code.size() < HeaderWords * 4)
+    {
+        return std::unexpected(Error::eShaderCreateFailed);
+    }
+    Module module;
+    module.Words.resize(code.size() / 4);
+    std::memcpy(module.Words.data(), code.data(), code.size());
+    if (module.Words[0] != Magic)
+    {
+        return std::unexpected(Error::eShaderCreateFailed);
+    }
+
+    const uint32_t bound = module.Words[3];
+    module.Definitions.assign(bound, 0);
+    module.SpecIds.assign(bound, None);
+    module.ArrayStrides.assign(bound, None);
+    module.Bindings.assign(bound, None);
+    module.DescriptorSets.assign(bound, None);
+    module.Members.resize(bound);
+
+    const auto& words = module.Words;
+    uint32_t entryId = None;
+    std::array localSize{None, None, None};
+    std::array localSizeIds{None, None, None};
+    std::vector<uint32_t> variables;
+    uint32_t pushConstantType = None;
+
+    // Every OpEntryPoint comes before the execution modes, so a single pass
+    // knows the chosen entry point by the time its modes show up
+    for (uint32_t i = HeaderWords; i < words.size();)
+    {
+        const uint32_t wordCount = words[i] >> 16;
+        const uint32_t opcode = words[i] & 0xFFFF;
+        if (wordCount == 0 || i + wordCount > words.size())
+        {
+            return std::unexpected(Error::eShaderCreateFailed);
+        }
+        const auto operands = std::span(words).subspan(i + 1, wordCount - 1);
+        const auto checkId = [bound](const uint32_t id)
+        {
+            return id < bound;
+        };
+
+        switch (opcode)
+        {
+        case eOpEntryPoint:
+        {
+            const auto* name =
+                reinterpret_cast<const char*>(operands.data() + 2);
+            const auto* nameEnd =
+                name + (operands.size() - 2) * sizeof(uint32_t);
+            const std::string entryName(name, std::find(name, nameEnd, '\0'));
+            if (const auto stage = GetStage(operands[0]))
+            {
+                reflection.EntryPoints.emplace_back(entryName, *stage);
+            }
+            if (entryName == specialization.EntryPoint)
+            {
+                entryId = operands[1];
+            }
+            break;
+        }
+        case eOpExecutionMode:
+        case eOpExecutionModeId:
+            if (operands[0] != entryId) break;
+            if (opcode == eOpExecutionMode &&
+                operands[1] == ExecutionModeLocalSize)
+            {
+                localSize = {operands[2], operands[3], operands[4]};
+            }
+            if (opcode == eOpExecutionModeId &&
+                operands[1] == ExecutionModeLocalSizeId)
+            {
+                localSizeIds = {operands[2], operands[3], operands[4]};
+            }
+            break;
+        case eOpDecorate:
+            if (!checkId(operands[0])) break;
+            switch (operands[1])
+            {
+            case eSpecId:
+                module.SpecIds[operands[0]] = operands[2];
+                break;
+            case eArrayStride:
+                module.ArrayStrides[operands[0]] = operands[2];
+                break;
+            case eBinding:
+                module.Bindings[operands[0]] = operands[2];
+                break;
+            case eDescriptorSet:
+                module.DescriptorSets[operands[0]] = operands[2];
+                break;
+            case eBuiltIn:
+                if (operands[2] == BuiltInWorkgroupSize)
+                {
+                    module.WorkgroupSize = operands[0];
+                }
+                break;
+            default:
+                break;
+            }
+            break;
+        case eOpMemberDecorate:
+        {
+            if (!checkId(operands[0])) break;
+            auto& members = module.Members[operands[0]];
+            if (members.size() <= operands[1])
+            {
+                members.resize(operands[1] + 1);
+            }
+            if (operands[2] == eOffset)
+            {
+                members[operands[1]].Offset = operands[3];
+            }
+            if (operands[2] == eMatrixStride)
+            {
+                members[operands[1]].MatrixStride = operands[3];
+            }
+            break;
+        }
+        case eOpTypeBool:
+        case eOpTypeInt:
+        case eOpTypeFloat:
+        case eOpTypeVector:
+        case eOpTypeMatrix:
+        case eOpTypeArray:
+        case eOpTypeRuntimeArray:
+        case eOpTypeStruct:
+        case eOpTypePointer:
+            if (checkId(operands[0])) module.Definitions[operands[0]] = i;
+            break;
+        case eOpConstant:
+        case eOpConstantComposite:
+        case eOpSpecConstant:
+        case eOpSpecConstantComposite:
+            if (checkId(operands[1])) module.Definitions[operands[1]] = i;
+            break;
+        case eOpVariable:
+            if (!checkId(operands[1])) break;
+            module.Definitions[operands[1]] = i;
+            if (operands[2] == StorageClassPushConstant)
+            {
+                pushConstantType = operands[0];
+            }
+            variables.emplace_back(operands[1]);
+            break;
+        default:
+            break;
+        }
+        i += wordCount;
+    }
+
+    if (entryId == None)
+    {
+#ifdef SWIFT_DEBUG
+        std::cerr << "Swift: entry point " << specialization.EntryPoint
+                  << " not found in shader\n";
+#endif
+        return std::unexpected(Error::eShaderCreateFailed);
+    }
+
+    const auto& constants = specialization.Constants;
+    if (pushConstantType != None)
+    {
+        const uint32_t blockType = module.Operand(pushConstantType, 2);
+        reflection.PushConstantSize =
+            std::max(reflection.PushConstantSize,
+                     GetTypeSize(module, blockType, constants));
+    }
+
+    for (const auto variable : variables)
+    {
+        if (module.DescriptorSets[variable] == 0 &&
+            module.Bindings[variable] < 32)
+        {
+            reflection.BindingMask |= 1u << module.Bindings[variable];
+        }
+    }
+
+    // A WorkgroupSize built-in overrides the execution mode
+    if (module.WorkgroupSize != None)
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            localSize[axis] =
+                GetConstant(module,
+                            module.Operand(module.WorkgroupSize, 2 + axis),
+                            constants);
+        }
+    }
+    else if (localSizeIds[0] != None)
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            localSize[axis] =
+                GetConstant(module, localSizeIds[axis], constants);
+        }
+    }
+    if (localSize[0] != None && reflection.LocalSize[0] == 0)
+    {
+        reflection.LocalSize = localSize;
+    }
+    return {};
+}
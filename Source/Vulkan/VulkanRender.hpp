@@ -8,7 +8,8 @@ namespace Swift::Vulkan
     BeginRendering(const Command &command,
                    const std::vector<VkRenderingAttachmentInfo> &colorAttachments,
                    const VkRenderingAttachmentInfo &depthAttachment,
-                   const Int2 &Dimensions)
+                   const Int2 &Dimensions,
+                   const bool stencil = false)
     {
         const auto extent = VkExtent2D(Dimensions.x, Dimensions.y);
         const VkRect2D renderArea{
@@ -24,6 +25,8 @@ namespace Swift::Vulkan
             static_cast<uint32_t>(colorAttachments.size()),
             .pColorAttachments = colorAttachments.data(),
             .pDepthAttachment = &depthAttachment,
+            // Depth stencil formats are one attachment used for both
+            .pStencilAttachment = stencil ? &depthAttachment : nullptr,
         };
         vkCmdBeginRendering(command.Buffer, &renderingInfo);
     }
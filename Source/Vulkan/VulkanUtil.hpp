@@ -1,8 +1,10 @@
 #pragma once
 #include "VulkanConstants.hpp"
+#include "algorithm"
 #include "array"
 #include "expected"
 #include "iostream"
+#include "optional"
 #include "span"
 #include "volk.h"
 
@@ -28,6 +30,10 @@ namespace Swift::Vulkan
                               uint32_t baseArrayLayer = 0,
                               uint32_t layerCount = 1);
 
+    bool HasStencil(VkFormat format);
+
+    // Depth aspects of a format with stencil also transition the stencil,
+    // both aspects share one layout without separateDepthStencilLayouts
     VkImageMemoryBarrier2
     TransitionImage(Image& image,
                     VkImageLayout newLayout,
@@ -37,17 +43,51 @@ namespace Swift::Vulkan
     PipelineBarrier(VkCommandBuffer commandBuffer,
                     const std::vector<VkImageMemoryBarrier2>& imageBarrier);
 
+    void
+    PipelineBarrier(VkCommandBuffer commandBuffer,
+                    const std::vector<VkImageMemoryBarrier2>& imageBarriers,
+                    const std::vector<VkBufferMemoryBarrier2>& bufferBarriers);
+
+    bool IsWriteAccess(VkAccessFlags2 access);
+
+    bool IsReadVisible(const Buffer& buffer,
+                       VkPipelineStageFlags2 stage,
+                       VkAccessFlags2 access);
+
+    // The barrier an access needs after the buffer's recorded accesses, if
+    // any. The state is kept for the whole buffer, so the range has to cover
+    // everything the recorded accesses could have touched
+    std::optional<VkBufferMemoryBarrier2>
+    GetBufferBarrier(const Buffer& buffer,
+                     VkPipelineStageFlags2 dstStage,
+                     VkAccessFlags2 dstAccess,
+                     uint64_t offset = 0,
+                     uint64_t size = VK_WHOLE_SIZE);
+
+    // Only valid once the barrier GetBufferBarrier returned is recorded
+    void RecordBufferAccess(Buffer& buffer,
+                            VkPipelineStageFlags2 stage,
+                            VkAccessFlags2 access);
+
+    void GlobalBarrier(VkCommandBuffer commandBuffer,
+                       VkPipelineStageFlags2 srcStage,
+                       VkAccessFlags2 srcAccess,
+                       VkPipelineStageFlags2 dstStage,
+                       VkAccessFlags2 dstAccess);
+
     void BlitImage(const Command& command,
                    const Image& srcImage,
                    const Image& dstImage,
                    Int2 srcExtents,
                    Int2 dstExtents);
 
-    void UpdateDescriptorSampler(VkDevice device,
-                                 VkDescriptorSet descriptor,
-                                 VkSampler sampler,
-                                 VkImageView imageView,
-                                 uint32_t arrayElement);
+    void UpdateDescriptorSampler(
+        VkDevice device,
+        VkDescriptorSet descriptor,
+        VkSampler sampler,
+        VkImageView imageView,
+        uint32_t arrayElement,
+        VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
     void UpdateDescriptorImage(VkDevice device,
                                VkDescriptorSet descriptor,
@@ -61,10 +101,16 @@ namespace Swift::Vulkan
                       uint64_t offset,
                       uint64_t size);
 
+    void FillBuffer(VkCommandBuffer commandBuffer,
+                    VkBuffer buffer,
+                    uint32_t value,
+                    uint64_t offset,
+                    uint64_t size);
+
     void CopyBuffer(VkCommandBuffer commandBuffer,
                     VkBuffer srcBuffer,
                     VkBuffer dstBuffer,
-                    std::span<BufferCopy> copyRegions);
+                    std::span<const BufferCopy> copyRegions);
 
     void CopyBufferToImage(VkCommandBuffer commandBuffer,
                            VkBuffer srcBuffer,
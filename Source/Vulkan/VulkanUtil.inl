@@ -48,11 +48,23 @@ namespace Swift::Vulkan
         return range;
     }
 
+    inline bool HasStencil(const VkFormat format)
+    {
+        return format == VK_FORMAT_D16_UNORM_S8_UINT ||
+               format == VK_FORMAT_D24_UNORM_S8_UINT ||
+               format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+    }
+
     inline VkImageMemoryBarrier2
     TransitionImage(Image& image,
                     const VkImageLayout newLayout,
-                    const VkImageAspectFlags aspectMask)
+                    VkImageAspectFlags aspectMask)
     {
+        if ((aspectMask & VK_IMAGE_ASPECT_DEPTH_BIT) &&
+            HasStencil(image.Format))
+        {
+            aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+        }
         VkImageMemoryBarrier2 imageBarrier{
             .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
         imageBarrier.pNext = nullptr;
@@ -68,7 +80,7 @@ namespace Swift::Vulkan
 
         imageBarrier.subresourceRange =
             GetImageSubresourceRange(aspectMask,
-                                     0,
+                                     image.BaseMip,
                                      image.MipLevels,
                                      0,
                                      image.ArrayLayers);
@@ -90,6 +102,149 @@ namespace Swift::Vulkan
         vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
     }
 
+    inline void
+    PipelineBarrier(const VkCommandBuffer commandBuffer,
+                    const std::vector<VkImageMemoryBarrier2>& imageBarriers,
+                    const std::vector<VkBufferMemoryBarrier2>& bufferBarriers)
+    {
+        const VkDependencyInfo dependencyInfo{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .bufferMemoryBarrierCount =
+                static_cast<uint32_t>(bufferBarriers.size()),
+            .pBufferMemoryBarriers = bufferBarriers.data(),
+            .imageMemoryBarrierCount =
+                static_cast<uint32_t>(imageBarriers.size()),
+            .pImageMemoryBarriers = imageBarriers.data(),
+        };
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    }
+
+    inline bool IsWriteAccess(const VkAccessFlags2 access)
+    {
+        constexpr VkAccessFlags2 writeAccess =
+            VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+            VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT |
+            VK_ACCESS_2_MEMORY_WRITE_BIT;
+        return (access & writeAccess) != 0;
+    }
+
+    // A barrier only makes its access types visible to its own stages, so
+    // each stage of the read is checked against the reads recorded for it
+    inline bool IsReadVisible(const Buffer& buffer,
+                              const VkPipelineStageFlags2 stage,
+                              const VkAccessFlags2 access)
+    {
+        if (buffer.WriteStages == VK_PIPELINE_STAGE_2_NONE)
+        {
+            return true;
+        }
+        for (auto stages = stage; stages != 0; stages &= stages - 1)
+        {
+            const auto stageBit = stages & ~(stages - 1);
+            VkAccessFlags2 visibleAccess = VK_ACCESS_2_NONE;
+            for (const auto& read : buffer.Reads)
+            {
+                if (read.Stages & stageBit)
+                {
+                    visibleAccess |= read.Access;
+                }
+            }
+            if ((visibleAccess & access) != access)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline std::optional<VkBufferMemoryBarrier2>
+    GetBufferBarrier(const Buffer& buffer,
+                     const VkPipelineStageFlags2 dstStage,
+                     const VkAccessFlags2 dstAccess,
+                     const uint64_t offset,
+                     const uint64_t size)
+    {
+        VkBufferMemoryBarrier2 bufferBarrier{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+            .dstStageMask = dstStage,
+            .dstAccessMask = dstAccess,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = buffer.BaseBuffer,
+            .offset = offset,
+            .size = size,
+        };
+
+        if (IsWriteAccess(dstAccess))
+        {
+            // Waiting on the reads since the last write is an execution
+            // dependency only, nothing they did needs to be made available
+            bufferBarrier.srcStageMask = buffer.WriteStages;
+            for (const auto& read : buffer.Reads)
+            {
+                bufferBarrier.srcStageMask |= read.Stages;
+            }
+            bufferBarrier.srcAccessMask = buffer.WriteAccess;
+            if (bufferBarrier.srcStageMask == VK_PIPELINE_STAGE_2_NONE)
+            {
+                return std::nullopt;
+            }
+            return bufferBarrier;
+        }
+
+        // Reads only wait on the last write, and only once per stage and
+        // access type
+        if (IsReadVisible(buffer, dstStage, dstAccess))
+        {
+            return std::nullopt;
+        }
+        bufferBarrier.srcStageMask = buffer.WriteStages;
+        bufferBarrier.srcAccessMask = buffer.WriteAccess;
+        return bufferBarrier;
+    }
+
+    inline void RecordBufferAccess(Buffer& buffer,
+                                   const VkPipelineStageFlags2 stage,
+                                   const VkAccessFlags2 access)
+    {
+        if (IsWriteAccess(access))
+        {
+            buffer.WriteStages = stage;
+            buffer.WriteAccess = access;
+            buffer.Reads.clear();
+            return;
+        }
+        const auto it =
+            std::ranges::find(buffer.Reads, stage, &BufferRead::Stages);
+        if (it != buffer.Reads.end())
+        {
+            it->Access |= access;
+            return;
+        }
+        buffer.Reads.emplace_back(BufferRead{stage, access});
+    }
+
+    inline void GlobalBarrier(const VkCommandBuffer commandBuffer,
+                              const VkPipelineStageFlags2 srcStage,
+                              const VkAccessFlags2 srcAccess,
+                              const VkPipelineStageFlags2 dstStage,
+                              const VkAccessFlags2 dstAccess)
+    {
+        const VkMemoryBarrier2 memoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = srcStage,
+            .srcAccessMask = srcAccess,
+            .dstStageMask = dstStage,
+            .dstAccessMask = dstAccess,
+        };
+        const VkDependencyInfo dependencyInfo{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &memoryBarrier,
+        };
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    }
+
     inline void BlitImage(const Command& command,
                           const Image& srcImage,
                           const Image& dstImage,
@@ -133,12 +288,12 @@ namespace Swift::Vulkan
                                         const VkDescriptorSet descriptor,
                                         const VkSampler sampler,
                                         const VkImageView imageView,
-                                        const uint32_t arrayElement)
+                                        const uint32_t arrayElement,
+                                        const VkImageLayout imageLayout)
     {
-        VkDescriptorImageInfo imageInfo{
-            .sampler = sampler,
-            .imageView = imageView,
-            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        VkDescriptorImageInfo imageInfo{.sampler = sampler,
+                                        .imageView = imageView,
+                                        .imageLayout = imageLayout};
         const VkWriteDescriptorSet descriptorWrite{
             .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
             .dstSet = descriptor,
@@ -181,6 +336,15 @@ namespace Swift::Vulkan
         vkCmdUpdateBuffer(commandBuffer, buffer, offset, size, data);
     }
 
+    inline void FillBuffer(const VkCommandBuffer commandBuffer,
+                           const VkBuffer buffer,
+                           const uint32_t value,
+                           const uint64_t offset,
+                           const uint64_t size)
+    {
+        vkCmdFillBuffer(commandBuffer, buffer, offset, size, value);
+    }
+
     inline void CopyBuffer(const VkCommandBuffer commandBuffer,
                            const VkBuffer srcBuffer,
                            const VkBuffer dstBuffer,